@@ -67,6 +67,14 @@ typedef signed __int64 int64_t;
 #define DB_TOO_LONG         8
 #define DB_OUT_OF_SYNC      9
 #define DB_NO_DATA          10
+#define DB_TIMEOUT          11
+
+/*
+ * db_engine_t.db.mysql.flags
+ */
+#define DB_MYSQL_COMPRESS   1 /* use compressed protocol, zstd or zlib, if server supports it */
+#define DB_MYSQL_ZERO_COPY  2 /* string and binary values point into received packets, are not '\0' terminated and live until next fetch */
+#define DB_MYSQL_ABORT_KILL 4 /* closed result over abort_threshold is stopped by KILL QUERY from another connection instead of dropping connection */
 
 #define DB_TYPE_BOOL        1
 #define DB_TYPE_BYTE        2
@@ -99,6 +107,9 @@ typedef struct db_engine_t {
             const char* server;
             int port;
             int flags;
+            uint64_t abort_threshold; // bytes of unread rows skipped by db_result_close before aborting query, 0 to skip all
+            uint64_t fetch_size; // bytes of rows asked at once from server side cursor, see db_statement_exec_cursor
+            uint64_t read_ahead; // max bytes of rows db_result_fetch_rows reads ahead in background, 0 disables
         } mysql;
     } db;
 } db_engine_t;
@@ -154,20 +165,113 @@ typedef struct db_value_t {
     };
 } db_value_t;
 
+/*
+ * Column of fetched batch stored contiguously. Values array element type
+ * follows column type: char for DB_TYPE_BOOL and DB_TYPE_BYTE, short, int,
+ * int64_t, float, double, db_time_t, or db_date_t. Strings and binaries
+ * of row i are data[offsets[i]] .. data[offsets[i + 1]]
+ */
+typedef struct db_vector_t {
+    int type;                 // DB_TYPE_*
+    int count;                // rows in batch
+    unsigned char* validity;  // bit i is set when value of row i is not null
+    void* values;             // fixed size values, 0 for strings and binaries
+    uint64_t* offsets;        // count + 1 offsets into data
+    char* data;
+} db_vector_t;
+
+/*
+ * Destination of column values in caller's memory, value of row i goes
+ * to data + i * stride. Numbers are converted to type, strings are cut
+ * to size bytes with '\0' and binaries to size bytes. Optional is_null
+ * and length, which receives full size of strings and binaries, follow
+ * the same stride. Type 0 skips column
+ */
+typedef struct db_binding_t {
+    int type;         // DB_TYPE_*
+    void* data;
+    size_t stride;
+    uint64_t size;
+    char* is_null;
+    uint64_t* length;
+} db_binding_t;
+
+/*
+ * Parameter of db_statement_bind_struct, value is at base + offset.
+ * Strings and binaries are pointers there, null pointer binds null.
+ * Type 0 binds null
+ */
+typedef struct db_param_t {
+    int type;           // DB_TYPE_*
+    size_t offset;
+    size_t size_offset; // uint64_t size of binary
+    int by_ref;         // string or binary is not copied, see db_statement_bind_binary_ref
+} db_param_t;
+
+/*
+ * Receives large values by fragments
+ */
+typedef void (*db_write_fn)(void* arg, const char* data, size_t size);
+
+/*
+ * Produces large values by fragments. Returns count of bytes placed
+ * into data, 0 at the end of value, or negative value on failure
+ */
+typedef int (*db_read_fn)(void* arg, char* data, size_t size);
+
+/*
+ * Receives rows one by one, row is valid only during the call.
+ * Returning non zero stops the iteration
+ */
+typedef int (*db_row_fn)(void* arg, db_value_t* row, int num_columns);
+
 typedef struct db_session_t db_session_t;
 typedef struct db_connection_t db_connection_t;
 typedef struct db_statement_t db_statement_t;
 typedef struct db_result_t db_result_t;
+typedef struct db_row_t db_row_t;
+typedef struct db_rowset_t db_rowset_t;
+typedef struct db_future_t db_future_t;
+
+/*
+ * Work submitted by db_future_submit, runs in its own fiber on pooled
+ * connection. Result placed into result is handed to future's waiter
+ */
+typedef int (*db_task_fn)(db_connection_t* connection, void* arg, db_result_t** result);
 
 DB_EXTERN int db_session_start(api_loop_t* loop, db_engine_t* engine, db_session_t** session);
 DB_EXTERN int db_session_error(db_session_t* session, db_error_t* error);
 DB_EXTERN int db_session_close(db_session_t* session);
 
+/*
+ * Submitted tasks run in parallel on pooled connections and complete on
+ * session's loop. Timeout, 0 for infinite, is applied to each wakeup of
+ * waiting fiber, DB_TIMEOUT is returned when it passes. Connection and
+ * result of task are kept until db_future_close
+ */
+DB_EXTERN int db_future_submit(db_session_t* session, db_task_fn fn, void* arg, db_future_t** future);
+DB_EXTERN int db_future_submit_query(db_session_t* session, const char* sql, db_future_t** future);
+DB_EXTERN int db_future_wait(db_future_t* future, uint64_t timeout, db_result_t** result);
+DB_EXTERN int db_future_when_all(db_future_t** futures, int count, uint64_t timeout);
+DB_EXTERN int db_future_when_any(db_future_t** futures, int count, uint64_t timeout, int* index);
+DB_EXTERN void db_future_close(db_future_t* future);
+
 DB_EXTERN int db_connection_open(db_session_t* session, db_connection_t** connection);
 DB_EXTERN int db_connection_error(db_connection_t* connection, db_error_t* error);
 DB_EXTERN int db_connection_query(db_connection_t* connection, const char* sql, db_result_t** result);
+DB_EXTERN int db_connection_send_query(db_connection_t* connection, const char* sql);
+DB_EXTERN int db_connection_read_result(db_connection_t* connection, db_result_t** result);
 DB_EXTERN int db_connection_affected(db_connection_t* connection, uint64_t* affected);
 DB_EXTERN int db_connection_insert_id(db_connection_t* connection, uint64_t* insert_id);
+/*
+ * Runs LOAD DATA LOCAL INFILE query. Server may ask only for file of given
+ * name, which content is produced by fn, requests for other files are
+ * refused by DB_MISMATCH. On failure of fn connection is broken to abort
+ * the load, and has to be closed
+ */
+DB_EXTERN int db_connection_load(db_connection_t* connection, const char* sql, const char* name, db_read_fn fn, void* arg);
+DB_EXTERN int db_connection_load_file(db_connection_t* connection, const char* sql, const char* name, int fd);
+DB_EXTERN int db_connection_load_memory(db_connection_t* connection, const char* sql, const char* name, const void* data, uint64_t size);
 DB_EXTERN int db_connection_begin(db_connection_t* connection);
 DB_EXTERN int db_connection_commit(db_connection_t* connection);
 DB_EXTERN int db_connection_rollback(db_connection_t* connection);
@@ -190,13 +294,66 @@ DB_EXTERN int db_statement_bind_timestamp(db_statement_t* statement, int index,
 DB_EXTERN int db_statement_bind_string(db_statement_t* statement, int index, const char* value);
 DB_EXTERN int db_statement_bind_binary(db_statement_t* statement, int index, void* value, uint64_t size);
 DB_EXTERN int db_statement_bind_blob(db_statement_t* statement, int index, void* value, uint64_t size);
+DB_EXTERN int db_statement_bind_stream(db_statement_t* statement, int index, db_read_fn fn, void* arg);
+DB_EXTERN int db_statement_bind_file(db_statement_t* statement, int index, int fd);
+/*
+ * Value is not copied, it must stay unchanged until execution
+ */
+DB_EXTERN int db_statement_bind_string_ref(db_statement_t* statement, int index, const char* value);
+DB_EXTERN int db_statement_bind_binary_ref(db_statement_t* statement, int index, const void* value, uint64_t size);
+/*
+ * Binds all parameters from fields of struct at once
+ */
+DB_EXTERN int db_statement_bind_struct(db_statement_t* statement, db_param_t* params, int count, const void* base);
 DB_EXTERN int db_statement_exec(db_statement_t* statement, db_result_t** result);
+/*
+ * Executes statement with read only server side cursor, rows are
+ * transferred by batches while being fetched. Result does not hold
+ * connection between batches, so several cursors and other commands
+ * can be used by turns. Cursor is valid until its statement is executed
+ * again or closed, connection must stay open meanwhile
+ */
+DB_EXTERN int db_statement_exec_cursor(db_statement_t* statement, db_result_t** result);
+/*
+ * Executes statement once per row of caller's arrays, one binding per
+ * parameter, laid out as for db_result_bind. Strings are cut at '\0' or
+ * at size bytes when length is not given. Rows are sent without waiting
+ * for each response, affected rows are summed and insert id is of first
+ * row. Bound values are cleared after execution
+ */
+DB_EXTERN int db_statement_exec_batch(db_statement_t* statement, db_binding_t* bindings, int count, uint64_t rows);
+DB_EXTERN int db_statement_send_exec(db_statement_t* statement);
 DB_EXTERN int db_statement_close(db_statement_t* statement);
 
 DB_EXTERN int db_result_fetch_columns(db_result_t* result, db_column_t** columns, int* num_columns);
 DB_EXTERN int db_result_fetch_rows(db_result_t* result, db_value_t*** rows, int* count);
+DB_EXTERN int db_result_fetch_lazy(db_result_t* result, db_row_t*** rows, int* count);
+DB_EXTERN int db_result_fetch_rowset(db_result_t* result, db_rowset_t** rowset, int* count);
+DB_EXTERN int db_result_fetch_vectors(db_result_t* result, db_vector_t** vectors, int* count);
+DB_EXTERN int db_result_next_row(db_result_t* result, db_value_t** row);
+DB_EXTERN int db_result_bind(db_result_t* result, db_binding_t* bindings, int count);
+DB_EXTERN int db_result_fetch_bound(db_result_t* result, int* count);
+DB_EXTERN int db_result_fetch_each(db_result_t* result, db_row_fn fn, void* arg);
+DB_EXTERN int db_result_fetch_stream(db_result_t* result, int column, db_write_fn fn, void* arg, int* is_null);
+/*
+ * Reads whole response into memory, so that connection can be closed or
+ * reused while result is still fetched. Must be called before fetching
+ */
+DB_EXTERN int db_result_store(db_result_t* result);
 DB_EXTERN int db_result_close(db_result_t* result);
 
+DB_EXTERN int db_row_get(db_row_t* row, int column, db_value_t* value);
+
+DB_EXTERN int db_rowset_count(db_rowset_t* rowset);
+DB_EXTERN int db_rowset_is_null(db_rowset_t* rowset, int row, int column);
+DB_EXTERN int db_rowset_get_int64(db_rowset_t* rowset, int row, int column, int64_t* value);
+DB_EXTERN int db_rowset_get_double(db_rowset_t* rowset, int row, int column, double* value);
+DB_EXTERN int db_rowset_get_string(db_rowset_t* rowset, int row, int column, const char** value, uint64_t* size);
+DB_EXTERN int db_rowset_get_date(db_rowset_t* rowset, int row, int column, db_date_t* value);
+DB_EXTERN int db_rowset_get_time(db_rowset_t* rowset, int row, int column, db_time_t* value);
+DB_EXTERN size_t db_rowset_memory(db_rowset_t* rowset);
+DB_EXTERN void db_rowset_free(db_rowset_t* rowset);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -19,6 +19,14 @@
  * IN THE SOFTWARE.
  */
 
+#ifdef _WIN32
+#include <io.h> /* for _read */
+#else
+#include <unistd.h> /* for read */
+#endif
+
+#include <string.h> /* for strlen, memcpy */
+
 #include "db_common.h"
 #include "mysql/db_mysql.h"
 
@@ -57,6 +65,16 @@ int db_connection_query(db_connection_t* connection, const char* sql, db_result_
     return connection->session->iface.connection.query(connection, sql, result);
 }
 
+int db_connection_send_query(db_connection_t* connection, const char* sql)
+{
+    return connection->session->iface.connection.send_query(connection, sql);
+}
+
+int db_connection_read_result(db_connection_t* connection, db_result_t** result)
+{
+    return connection->session->iface.connection.read_result(connection, result);
+}
+
 int db_connection_affected(db_connection_t* connection, uint64_t* affected)
 {
     return connection->session->iface.connection.affected(connection, affected);
@@ -67,6 +85,11 @@ int db_connection_insert_id(db_connection_t* connection, uint64_t* insert_id)
     return connection->session->iface.connection.insert_id(connection, insert_id);
 }
 
+int db_connection_load(db_connection_t* connection, const char* sql, const char* name, db_read_fn fn, void* arg)
+{
+    return connection->session->iface.connection.load(connection, sql, name, fn, arg);
+}
+
 int db_connection_begin(db_connection_t* connection)
 {
     return connection->session->iface.connection.begin(connection);
@@ -167,11 +190,103 @@ int db_statement_bind_blob(db_statement_t* statement, int index, void* value, ui
     return statement->connection->session->iface.statement.bind_blob(statement, index, value, size);
 }
 
+int db_statement_bind_stream(db_statement_t* statement, int index, db_read_fn fn, void* arg)
+{
+    return statement->connection->session->iface.statement.bind_stream(statement, index, fn, arg);
+}
+
+static int db_read_fd(void* arg, char* data, size_t size)
+{
+#ifdef _WIN32
+    return _read(*(int*)arg, data, (unsigned int)size);
+#else
+    return (int)read(*(int*)arg, data, size);
+#endif
+}
+
+int db_statement_bind_file(db_statement_t* statement, int index, int fd)
+{
+    /*
+     * File is read till the end by chunks, fd stays opened
+     */
+    return db_statement_bind_stream(statement, index, db_read_fd, &fd);
+}
+
+int db_connection_load_file(db_connection_t* connection, const char* sql, const char* name, int fd)
+{
+    /*
+     * File is read till the end by chunks, fd stays opened
+     */
+    return db_connection_load(connection, sql, name, db_read_fd, &fd);
+}
+
+typedef struct db_memory_t {
+    const char* data;
+    uint64_t size;
+} db_memory_t;
+
+static int db_read_memory(void* arg, char* data, size_t size)
+{
+    db_memory_t* memory = (db_memory_t*)arg;
+
+    if (size > memory->size)
+        size = (size_t)memory->size;
+
+    memcpy(data, memory->data, size);
+    memory->data += size;
+    memory->size -= size;
+
+    return (int)size;
+}
+
+int db_connection_load_memory(db_connection_t* connection, const char* sql, const char* name, const void* data, uint64_t size)
+{
+    db_memory_t memory;
+
+    /*
+     * Region may be mapped file, its pages are touched chunk by chunk
+     */
+    memory.data = (const char*)data;
+    memory.size = size;
+
+    return db_connection_load(connection, sql, name, db_read_memory, &memory);
+}
+
+int db_statement_bind_string_ref(db_statement_t* statement, int index, const char* value)
+{
+    return statement->connection->session->iface.statement.bind_ref(statement, index, value, strlen(value));
+}
+
+int db_statement_bind_binary_ref(db_statement_t* statement, int index, const void* value, uint64_t size)
+{
+    return statement->connection->session->iface.statement.bind_ref(statement, index, value, size);
+}
+
+int db_statement_bind_struct(db_statement_t* statement, db_param_t* params, int count, const void* base)
+{
+    return statement->connection->session->iface.statement.bind_struct(statement, params, count, base);
+}
+
 int db_statement_exec(db_statement_t* statement, db_result_t** result)
 {
     return statement->connection->session->iface.statement.exec(statement, result);
 }
 
+int db_statement_exec_cursor(db_statement_t* statement, db_result_t** result)
+{
+    return statement->connection->session->iface.statement.exec_cursor(statement, result);
+}
+
+int db_statement_exec_batch(db_statement_t* statement, db_binding_t* bindings, int count, uint64_t rows)
+{
+    return statement->connection->session->iface.statement.exec_batch(statement, bindings, count, rows);
+}
+
+int db_statement_send_exec(db_statement_t* statement)
+{
+    return statement->connection->session->iface.statement.send_exec(statement);
+}
+
 int db_statement_close(db_statement_t* statement)
 {
     return statement->connection->session->iface.statement.close(statement);
@@ -187,11 +302,61 @@ int db_result_fetch_rows(db_result_t* result, db_value_t*** rows, int* count)
     return result->connection->session->iface.result.fetch_rows(result, rows, count);
 }
 
+int db_result_fetch_lazy(db_result_t* result, db_row_t*** rows, int* count)
+{
+    return result->connection->session->iface.result.fetch_lazy(result, rows, count);
+}
+
+int db_result_fetch_rowset(db_result_t* result, db_rowset_t** rowset, int* count)
+{
+    return result->connection->session->iface.result.fetch_rowset(result, rowset, count);
+}
+
+int db_result_fetch_vectors(db_result_t* result, db_vector_t** vectors, int* count)
+{
+    return result->connection->session->iface.result.fetch_vectors(result, vectors, count);
+}
+
+int db_result_next_row(db_result_t* result, db_value_t** row)
+{
+    return result->connection->session->iface.result.next_row(result, row);
+}
+
+int db_result_fetch_each(db_result_t* result, db_row_fn fn, void* arg)
+{
+    return result->connection->session->iface.result.fetch_each(result, fn, arg);
+}
+
+int db_result_fetch_stream(db_result_t* result, int column, db_write_fn fn, void* arg, int* is_null)
+{
+    return result->connection->session->iface.result.fetch_stream(result, column, fn, arg, is_null);
+}
+
+int db_result_bind(db_result_t* result, db_binding_t* bindings, int count)
+{
+    return result->connection->session->iface.result.bind(result, bindings, count);
+}
+
+int db_result_fetch_bound(db_result_t* result, int* count)
+{
+    return result->connection->session->iface.result.fetch_bound(result, count);
+}
+
+int db_result_store(db_result_t* result)
+{
+    return result->connection->session->iface.result.store(result);
+}
+
 int db_result_close(db_result_t* result)
 {
     return result->connection->session->iface.result.close(result);
 }
 
+int db_row_get(db_row_t* row, int column, db_value_t* value)
+{
+    return row->result->connection->session->iface.row.get(row, column, value);
+}
+
 /*
  * Connection pooling
  */
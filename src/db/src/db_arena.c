@@ -0,0 +1,98 @@
+/* Copyright (c) 2014, Artak Khnkoyan <artak.khnkoyan@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "db_common.h"
+
+#define DB_ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+void db_arena_init(db_arena_t* arena, api_pool_t* pool, size_t chunk_size)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->pool = pool;
+    arena->chunk_size = chunk_size;
+}
+
+void* db_arena_alloc(db_arena_t* arena, size_t size)
+{
+    db_arena_chunk_t* chunk;
+    char* ptr;
+
+    size = DB_ARENA_ALIGN(size);
+
+    if ((size_t)(arena->end - arena->pos) < size)
+    {
+        chunk = arena->current != 0 ? arena->current->next : arena->head;
+
+        if (chunk == 0 || chunk->size < size)
+        {
+            /*
+             * Next chunk is missing or too small, put new one before it.
+             * Oversized requests get their own chunk
+             */
+            chunk = (db_arena_chunk_t*)api_alloc(arena->pool,
+                sizeof(db_arena_chunk_t) + (size > arena->chunk_size ? size : arena->chunk_size));
+            chunk->size = size > arena->chunk_size ? size : arena->chunk_size;
+
+            if (arena->current != 0)
+            {
+                chunk->next = arena->current->next;
+                arena->current->next = chunk;
+            }
+            else
+            {
+                chunk->next = arena->head;
+                arena->head = chunk;
+            }
+        }
+
+        arena->current = chunk;
+        arena->pos = (char*)(chunk + 1);
+        arena->end = arena->pos + chunk->size;
+    }
+
+    ptr = arena->pos;
+    arena->pos += size;
+
+    return ptr;
+}
+
+void db_arena_reset(db_arena_t* arena)
+{
+    arena->current = 0;
+    arena->pos = 0;
+    arena->end = 0;
+}
+
+void db_arena_free(db_arena_t* arena)
+{
+    db_arena_chunk_t* chunk = arena->head;
+    db_arena_chunk_t* next;
+
+    while (chunk != 0)
+    {
+        next = chunk->next;
+        api_free(arena->pool, sizeof(db_arena_chunk_t) + chunk->size, chunk);
+        chunk = next;
+    }
+
+    arena->head = 0;
+    db_arena_reset(arena);
+}
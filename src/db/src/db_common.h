@@ -32,8 +32,11 @@ typedef int (*db_connection_create_fn)(db_session_t* session, db_connection_t**
 typedef int (*db_connection_open_fn)(db_session_t* session, db_connection_t** connection);
 typedef int (*db_connection_error_fn)(db_connection_t* connection, db_error_t* error);
 typedef int (*db_connection_query_fn)(db_connection_t* connection, const char* sql, db_result_t** result);
+typedef int (*db_connection_send_query_fn)(db_connection_t* connection, const char* sql);
+typedef int (*db_connection_read_result_fn)(db_connection_t* connection, db_result_t** result);
 typedef int (*db_connection_affected_fn)(db_connection_t* connection, uint64_t* affected);
 typedef int (*db_connection_insert_id_fn)(db_connection_t* connection, uint64_t* insert_id);
+typedef int (*db_connection_load_fn)(db_connection_t* connection, const char* sql, const char* name, db_read_fn fn, void* arg);
 typedef int (*db_connection_begin_fn)(db_connection_t* connection);
 typedef int (*db_connection_commit_fn)(db_connection_t* connection);
 typedef int (*db_connection_rollback_fn)(db_connection_t* connection);
@@ -57,13 +60,29 @@ typedef int (*db_statement_bind_timestamp_fn)(db_statement_t* statement, int ind
 typedef int (*db_statement_bind_string_fn)(db_statement_t* statement, int index, const char* value);
 typedef int (*db_statement_bind_binary_fn)(db_statement_t* statement, int index, void* value, uint64_t size);
 typedef int (*db_statement_bind_blob_fn)(db_statement_t* statement, int index, void* value, uint64_t size);
+typedef int (*db_statement_bind_stream_fn)(db_statement_t* statement, int index, db_read_fn fn, void* arg);
+typedef int (*db_statement_bind_ref_fn)(db_statement_t* statement, int index, const void* value, uint64_t size);
+typedef int (*db_statement_bind_struct_fn)(db_statement_t* statement, db_param_t* params, int count, const void* base);
 typedef int (*db_statement_exec_fn)(db_statement_t* statement, db_result_t** result);
+typedef int (*db_statement_exec_batch_fn)(db_statement_t* statement, db_binding_t* bindings, int count, uint64_t rows);
+typedef int (*db_statement_send_exec_fn)(db_statement_t* statement);
 typedef int (*db_statement_close_fn)(db_statement_t* statement);
 
 typedef int (*db_result_fetch_columns_fn)(db_result_t* result, db_column_t** columns, int* num_columns);
 typedef int (*db_result_fetch_rows_fn)(db_result_t* result, db_value_t*** rows, int* count);
+typedef int (*db_result_fetch_lazy_fn)(db_result_t* result, db_row_t*** rows, int* count);
+typedef int (*db_result_fetch_rowset_fn)(db_result_t* result, db_rowset_t** rowset, int* count);
+typedef int (*db_result_fetch_vectors_fn)(db_result_t* result, db_vector_t** vectors, int* count);
+typedef int (*db_result_next_row_fn)(db_result_t* result, db_value_t** row);
+typedef int (*db_result_fetch_each_fn)(db_result_t* result, db_row_fn fn, void* arg);
+typedef int (*db_result_fetch_stream_fn)(db_result_t* result, int column, db_write_fn fn, void* arg, int* is_null);
+typedef int (*db_result_bind_fn)(db_result_t* result, db_binding_t* bindings, int count);
+typedef int (*db_result_fetch_bound_fn)(db_result_t* result, int* count);
+typedef int (*db_result_store_fn)(db_result_t* result);
 typedef int (*db_result_close_fn)(db_result_t* result);
 
+typedef int (*db_row_get_fn)(db_row_t* row, int column, db_value_t* value);
+
 typedef struct db_iface_t {
 	struct {
         db_session_error_fn error;
@@ -74,8 +93,11 @@ typedef struct db_iface_t {
         db_connection_open_fn open;
         db_connection_error_fn error;
         db_connection_query_fn query;
+        db_connection_send_query_fn send_query;
+        db_connection_read_result_fn read_result;
         db_connection_affected_fn affected;
         db_connection_insert_id_fn insert_id;
+        db_connection_load_fn load;
         db_connection_begin_fn begin;
         db_connection_commit_fn commit;
         db_connection_rollback_fn rollback;
@@ -100,14 +122,32 @@ typedef struct db_iface_t {
 		db_statement_bind_string_fn bind_string;
 		db_statement_bind_binary_fn bind_binary;
 		db_statement_bind_blob_fn bind_blob;
+		db_statement_bind_stream_fn bind_stream;
+		db_statement_bind_ref_fn bind_ref;
+		db_statement_bind_struct_fn bind_struct;
 		db_statement_exec_fn exec;
+		db_statement_exec_fn exec_cursor;
+		db_statement_exec_batch_fn exec_batch;
+		db_statement_send_exec_fn send_exec;
 		db_statement_close_fn close;
 	} statement;
 	struct {
         db_result_fetch_columns_fn fetch_columns;
         db_result_fetch_rows_fn fetch_rows;
+        db_result_fetch_lazy_fn fetch_lazy;
+        db_result_fetch_rowset_fn fetch_rowset;
+        db_result_fetch_vectors_fn fetch_vectors;
+        db_result_next_row_fn next_row;
+        db_result_fetch_each_fn fetch_each;
+        db_result_fetch_stream_fn fetch_stream;
+        db_result_bind_fn bind;
+        db_result_fetch_bound_fn fetch_bound;
+        db_result_store_fn store;
         db_result_close_fn close;
 	} result;
+	struct {
+        db_row_get_fn get;
+	} row;
 } db_iface_t;
 
 typedef struct db_pool_t {
@@ -119,6 +159,40 @@ typedef struct db_pool_t {
     int pool_size;
 } db_pool_t;
 
+/*
+ * Bump allocator. Chunks are kept on reset and reused by next allocations,
+ * so that memory of many small objects is released at once
+ */
+typedef struct db_arena_chunk_t {
+    struct db_arena_chunk_t* next;
+    size_t size; // usable bytes following the header
+} db_arena_chunk_t;
+
+typedef struct db_arena_t {
+    api_pool_t* pool;
+    size_t chunk_size;
+    db_arena_chunk_t* head;
+    db_arena_chunk_t* current;
+    char* pos;
+    char* end;
+} db_arena_t;
+
+/*
+ * Rows detached from result, see db_rowset.c for layout
+ */
+typedef struct db_rowset_t {
+    api_pool_t* pool;
+    int num_columns;
+    int* types;
+    int num_rows;
+    int capacity; // rows allocated
+    size_t row_size;
+    char* rows;
+    char* heap; // long strings and temporal values
+    size_t heap_size;
+    size_t heap_capacity;
+} db_rowset_t;
+
 typedef struct db_session_t {
 	db_iface_t iface;
     db_error_t error;
@@ -144,9 +218,37 @@ typedef struct db_result_t {
     db_connection_t* connection;
 } db_result_t;
 
+typedef struct db_row_t {
+    db_result_t* result;
+} db_row_t;
+
+#define DB_FUTURE_STACK (64 * 1024)
+
+typedef struct db_future_t {
+    db_session_t* session;
+    db_task_fn fn;
+    void* arg;
+    char* sql; // query text copy, see db_future_submit_query
+    size_t sql_size;
+    db_connection_t* connection;
+    db_result_t* result;
+    int code;
+    int done;
+    api_event_t event;
+    api_event_t* waiter; // of db_future_when_all or db_future_when_any
+} db_future_t;
+
 void db_error_override(api_pool_t* pool, db_error_t* dst, db_error_t* src);
 void db_error_cleanup(api_pool_t* pool, db_error_t* error);
 
+void db_arena_init(db_arena_t* arena, api_pool_t* pool, size_t chunk_size);
+void* db_arena_alloc(db_arena_t* arena, size_t size);
+void db_arena_reset(db_arena_t* arena);
+void db_arena_free(db_arena_t* arena);
+
+db_rowset_t* db_rowset_create(api_pool_t* pool, db_column_t* columns, int num_columns);
+void db_rowset_append(db_rowset_t* rowset, db_value_t* row, int int64_values);
+
 int db_pool_open_connection(db_session_t* session, db_connection_t** connection);
 int db_pool_close_connection(db_connection_t* connection);
 int db_pool_destroy(db_session_t* session);
@@ -0,0 +1,229 @@
+/* Copyright (c) 2014, Artak Khnkoyan <artak.khnkoyan@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "db_common.h"
+
+static void db_future_complete(db_future_t* future, int code)
+{
+    future->code = code;
+    future->done = 1;
+
+    api_event_signal(&future->event, future->session->loop);
+
+    if (future->waiter != 0)
+        api_event_signal(future->waiter, future->session->loop);
+}
+
+/*
+ * Fiber of submitted task, runs it on pooled connection
+ */
+static void db_future_run(api_loop_t* loop, void* arg)
+{
+    db_future_t* future = (db_future_t*)arg;
+    int code;
+
+    code = future->session->iface.connection.open(future->session, &future->connection);
+    if (DB_OK == code)
+        code = future->fn(future->connection, future->arg, &future->result);
+
+    db_future_complete(future, code);
+}
+
+static int db_future_query(db_connection_t* connection, void* arg, db_result_t** result)
+{
+    return connection->session->iface.connection.query(connection, (const char*)arg, result);
+}
+
+int db_future_submit(db_session_t* session, db_task_fn fn, void* arg, db_future_t** future)
+{
+    api_pool_t* pool = api_pool_default(session->loop);
+    db_future_t* submitted;
+
+    submitted = (db_future_t*)api_calloc(pool, sizeof(*submitted));
+    submitted->session = session;
+    submitted->fn = fn;
+    submitted->arg = arg;
+
+    api_event_init(&submitted->event, session->loop);
+
+    if (API_OK != api_loop_post(session->loop, db_future_run, submitted, DB_FUTURE_STACK))
+    {
+        api_free(pool, sizeof(*submitted), submitted);
+        *future = 0;
+        return DB_UNAVAILABLE;
+    }
+
+    *future = submitted;
+
+    return DB_OK;
+}
+
+int db_future_submit_query(db_session_t* session, const char* sql, db_future_t** future)
+{
+    api_pool_t* pool = api_pool_default(session->loop);
+    size_t length = strlen(sql);
+    char* copy;
+    int code;
+
+    /*
+     * Query text must outlive the call
+     */
+    copy = (char*)api_alloc(pool, length + 1);
+    memcpy(copy, sql, length + 1);
+
+    code = db_future_submit(session, db_future_query, copy, future);
+    if (DB_OK != code)
+    {
+        api_free(pool, length + 1, copy);
+        return code;
+    }
+
+    (*future)->sql = copy;
+    (*future)->sql_size = length + 1;
+
+    return DB_OK;
+}
+
+int db_future_wait(db_future_t* future, uint64_t timeout, db_result_t** result)
+{
+    if (result != 0)
+        *result = 0;
+
+    while (!future->done)
+    {
+        if (API_OK != api_event_wait(&future->event, timeout))
+            return DB_TIMEOUT;
+    }
+
+    if (result != 0)
+        *result = future->result;
+
+    return future->code;
+}
+
+/*
+ * Waits until count futures in list are completed, or timeout passes
+ * without any of them completing
+ */
+static int db_future_wait_list(db_future_t** futures, int count, int needed, uint64_t timeout)
+{
+    api_event_t waiter;
+    int completed;
+    int code = DB_OK;
+    int i;
+
+    if (count == 0)
+        return DB_OK;
+
+    api_event_init(&waiter, futures[0]->session->loop);
+
+    while (1)
+    {
+        completed = 0;
+        for (i = 0; i < count; ++i)
+        {
+            if (futures[i]->done)
+                ++completed;
+            else
+                futures[i]->waiter = &waiter;
+        }
+
+        if (completed >= needed)
+            break;
+
+        if (API_OK != api_event_wait(&waiter, timeout))
+        {
+            code = DB_TIMEOUT;
+            break;
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+        futures[i]->waiter = 0;
+
+    return code;
+}
+
+int db_future_when_all(db_future_t** futures, int count, uint64_t timeout)
+{
+    int code;
+    int i;
+
+    code = db_future_wait_list(futures, count, count, timeout);
+    if (DB_OK != code)
+        return code;
+
+    /*
+     * First failure if any
+     */
+    for (i = 0; i < count; ++i)
+    {
+        if (DB_OK != futures[i]->code)
+            return futures[i]->code;
+    }
+
+    return DB_OK;
+}
+
+int db_future_when_any(db_future_t** futures, int count, uint64_t timeout, int* index)
+{
+    int code;
+    int i;
+
+    *index = -1;
+
+    code = db_future_wait_list(futures, count, 1, timeout);
+    if (DB_OK != code)
+        return code;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (futures[i]->done)
+        {
+            *index = i;
+            return futures[i]->code;
+        }
+    }
+
+    return DB_NO_DATA;
+}
+
+void db_future_close(db_future_t* future)
+{
+    api_pool_t* pool = api_pool_default(future->session->loop);
+
+    /*
+     * Task can't be cancelled, its fiber references future
+     */
+    while (!future->done)
+        api_event_wait(&future->event, 0);
+
+    if (future->result != 0)
+        db_result_close(future->result);
+
+    if (future->connection != 0)
+        db_connection_close(future->connection);
+
+    if (future->sql != 0)
+        api_free(pool, future->sql_size, future->sql);
+
+    api_free(pool, sizeof(*future), future);
+}
@@ -0,0 +1,385 @@
+/* Copyright (c) 2014, Artak Khnkoyan <artak.khnkoyan@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Compact rows. Each row is 8 byte slot per column followed by packed
+ * null bitmap padded to 8 bytes. Slots keep numbers in place, strings
+ * up to 6 bytes inline, longer strings and temporal values in heap
+ */
+
+#include "db_common.h"
+
+#define DB_ROWSET_INLINE    6    // max inline string, slot[7] is its length
+#define DB_ROWSET_HEAP      0xff // slot[7] of strings stored in heap
+
+#define DB_ROWSET_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+static unsigned char* db_rowset_slot(db_rowset_t* rowset, int row, int column)
+{
+    return (unsigned char*)rowset->rows + row * rowset->row_size + column * 8;
+}
+
+/*
+ * Reserves size bytes in heap, returns offset of them
+ */
+static uint32_t db_rowset_heap_alloc(db_rowset_t* rowset, size_t size)
+{
+    size_t capacity = rowset->heap_capacity;
+    size_t offset = rowset->heap_size;
+    char* heap;
+
+    size = DB_ROWSET_ALIGN(size);
+
+    if (offset + size > capacity)
+    {
+        capacity = capacity > 0 ? 2 * capacity : 4096;
+        if (capacity < offset + size)
+            capacity = offset + size;
+
+        heap = (char*)api_alloc(rowset->pool, capacity);
+
+        if (rowset->heap_capacity > 0)
+        {
+            memcpy(heap, rowset->heap, offset);
+            api_free(rowset->pool, rowset->heap_capacity, rowset->heap);
+        }
+
+        rowset->heap = heap;
+        rowset->heap_capacity = capacity;
+    }
+
+    rowset->heap_size += size;
+
+    return (uint32_t)offset;
+}
+
+db_rowset_t* db_rowset_create(api_pool_t* pool, db_column_t* columns, int num_columns)
+{
+    db_rowset_t* rowset = (db_rowset_t*)api_calloc(pool, sizeof(db_rowset_t));
+    int i;
+
+    rowset->pool = pool;
+    rowset->num_columns = num_columns;
+    rowset->row_size = 8 * num_columns + DB_ROWSET_ALIGN((num_columns + 7) / 8);
+
+    if (num_columns > 0)
+    {
+        rowset->types = (int*)api_alloc(pool, num_columns * sizeof(int));
+
+        for (i = 0; i < num_columns; ++i)
+            rowset->types[i] = columns[i].type;
+    }
+
+    return rowset;
+}
+
+void db_rowset_append(db_rowset_t* rowset, db_value_t* row, int int64_values)
+{
+    unsigned char* slot;
+    unsigned char* bitmap;
+    char* rows;
+    int64_t number;
+    uint64_t size;
+    uint32_t offset;
+    int capacity;
+    int i;
+
+    if (rowset->num_rows == rowset->capacity)
+    {
+        capacity = rowset->capacity > 0 ? 2 * rowset->capacity : 64;
+        rows = (char*)api_alloc(rowset->pool, capacity * rowset->row_size);
+
+        if (rowset->capacity > 0)
+        {
+            memcpy(rows, rowset->rows, rowset->num_rows * rowset->row_size);
+            api_free(rowset->pool, rowset->capacity * rowset->row_size, rowset->rows);
+        }
+
+        rowset->rows = rows;
+        rowset->capacity = capacity;
+    }
+
+    slot = db_rowset_slot(rowset, rowset->num_rows, 0);
+    bitmap = slot + 8 * rowset->num_columns;
+
+    memset(slot, 0, rowset->row_size);
+
+    for (i = 0; i < rowset->num_columns; ++i, slot += 8)
+    {
+        if (row[i].is_null)
+        {
+            bitmap[i / 8] |= (unsigned char)(1 << (i % 8));
+            continue;
+        }
+
+        switch (rowset->types[i])
+        {
+        case DB_TYPE_BOOL:
+        case DB_TYPE_BYTE:
+            number = int64_values ? row[i].value_int64 : row[i].value_byte;
+            memcpy(slot, &number, 8);
+            break;
+        case DB_TYPE_SHORT:
+            number = int64_values ? row[i].value_int64 : row[i].value_short;
+            memcpy(slot, &number, 8);
+            break;
+        case DB_TYPE_INT:
+            number = int64_values ? row[i].value_int64 : row[i].value_int;
+            memcpy(slot, &number, 8);
+            break;
+        case DB_TYPE_INT64:
+            memcpy(slot, &row[i].value_int64, 8);
+            break;
+        case DB_TYPE_FLOAT:
+            memcpy(slot, &row[i].value_float, sizeof(float));
+            break;
+        case DB_TYPE_DOUBLE:
+            memcpy(slot, &row[i].value_double, 8);
+            break;
+        case DB_TYPE_TIME:
+            offset = db_rowset_heap_alloc(rowset, sizeof(db_time_t));
+            memcpy(rowset->heap + offset, &row[i].value_time, sizeof(db_time_t));
+            memcpy(slot, &offset, 4);
+            break;
+        case DB_TYPE_DATE:
+        case DB_TYPE_DATETIME:
+        case DB_TYPE_TIMESTAMP:
+            offset = db_rowset_heap_alloc(rowset, sizeof(db_date_t));
+            memcpy(rowset->heap + offset, &row[i].value_date, sizeof(db_date_t));
+            memcpy(slot, &offset, 4);
+            break;
+        default: // DB_TYPE_STRING or DB_TYPE_BINARY
+            size = row[i].size;
+
+            if (size <= DB_ROWSET_INLINE)
+            {
+                /*
+                 * Zeroed slot keeps trailing '\0'
+                 */
+                memcpy(slot, row[i].value_string, (size_t)size);
+                slot[7] = (unsigned char)size;
+            }
+            else
+            {
+                /*
+                 * Heap keeps [uint64 size][data]['\0']
+                 */
+                offset = db_rowset_heap_alloc(rowset, 8 + (size_t)size + 1);
+                memcpy(rowset->heap + offset, &size, 8);
+                memcpy(rowset->heap + offset + 8, row[i].value_string, (size_t)size);
+                rowset->heap[offset + 8 + size] = 0;
+                memcpy(slot, &offset, 4);
+                slot[7] = DB_ROWSET_HEAP;
+            }
+            break;
+        }
+    }
+
+    ++rowset->num_rows;
+}
+
+/*
+ * Checks bounds and null flag, returns slot of value or 0
+ */
+static unsigned char* db_rowset_value(db_rowset_t* rowset, int row, int column, int* code)
+{
+    unsigned char* bitmap;
+
+    if (row < 0 || row >= rowset->num_rows || column < 0 || column >= rowset->num_columns)
+    {
+        *code = DB_OUT_OF_INDEX;
+        return 0;
+    }
+
+    bitmap = db_rowset_slot(rowset, row, rowset->num_columns);
+    if (bitmap[column / 8] & (1 << (column % 8)))
+    {
+        *code = DB_NO_DATA;
+        return 0;
+    }
+
+    *code = DB_OK;
+
+    return db_rowset_slot(rowset, row, column);
+}
+
+int db_rowset_count(db_rowset_t* rowset)
+{
+    return rowset->num_rows;
+}
+
+int db_rowset_is_null(db_rowset_t* rowset, int row, int column)
+{
+    int code;
+
+    return 0 == db_rowset_value(rowset, row, column, &code) && DB_NO_DATA == code;
+}
+
+int db_rowset_get_int64(db_rowset_t* rowset, int row, int column, int64_t* value)
+{
+    unsigned char* slot;
+    int code;
+
+    *value = 0;
+
+    slot = db_rowset_value(rowset, row, column, &code);
+    if (slot == 0)
+        return code;
+
+    switch (rowset->types[column])
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+    case DB_TYPE_SHORT:
+    case DB_TYPE_INT:
+    case DB_TYPE_INT64:
+        memcpy(value, slot, 8);
+        return DB_OK;
+    }
+
+    return DB_MISMATCH;
+}
+
+int db_rowset_get_double(db_rowset_t* rowset, int row, int column, double* value)
+{
+    unsigned char* slot;
+    float number;
+    int code;
+
+    *value = 0;
+
+    slot = db_rowset_value(rowset, row, column, &code);
+    if (slot == 0)
+        return code;
+
+    switch (rowset->types[column])
+    {
+    case DB_TYPE_FLOAT:
+        memcpy(&number, slot, sizeof(float));
+        *value = number;
+        return DB_OK;
+    case DB_TYPE_DOUBLE:
+        memcpy(value, slot, 8);
+        return DB_OK;
+    }
+
+    return DB_MISMATCH;
+}
+
+int db_rowset_get_string(db_rowset_t* rowset, int row, int column, const char** value, uint64_t* size)
+{
+    unsigned char* slot;
+    uint32_t offset;
+    int code;
+
+    *value = 0;
+    *size = 0;
+
+    slot = db_rowset_value(rowset, row, column, &code);
+    if (slot == 0)
+        return code;
+
+    if (rowset->types[column] != DB_TYPE_STRING && rowset->types[column] != DB_TYPE_BINARY)
+        return DB_MISMATCH;
+
+    if (slot[7] == DB_ROWSET_HEAP)
+    {
+        memcpy(&offset, slot, 4);
+        memcpy(size, rowset->heap + offset, 8);
+        *value = rowset->heap + offset + 8;
+    }
+    else
+    {
+        *size = slot[7];
+        *value = (const char*)slot;
+    }
+
+    return DB_OK;
+}
+
+int db_rowset_get_date(db_rowset_t* rowset, int row, int column, db_date_t* value)
+{
+    unsigned char* slot;
+    uint32_t offset;
+    int code;
+
+    memset(value, 0, sizeof(*value));
+
+    slot = db_rowset_value(rowset, row, column, &code);
+    if (slot == 0)
+        return code;
+
+    switch (rowset->types[column])
+    {
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        memcpy(&offset, slot, 4);
+        memcpy(value, rowset->heap + offset, sizeof(*value));
+        return DB_OK;
+    }
+
+    return DB_MISMATCH;
+}
+
+int db_rowset_get_time(db_rowset_t* rowset, int row, int column, db_time_t* value)
+{
+    unsigned char* slot;
+    uint32_t offset;
+    int code;
+
+    memset(value, 0, sizeof(*value));
+
+    slot = db_rowset_value(rowset, row, column, &code);
+    if (slot == 0)
+        return code;
+
+    if (rowset->types[column] != DB_TYPE_TIME)
+        return DB_MISMATCH;
+
+    memcpy(&offset, slot, 4);
+    memcpy(value, rowset->heap + offset, sizeof(*value));
+
+    return DB_OK;
+}
+
+size_t db_rowset_memory(db_rowset_t* rowset)
+{
+    /*
+     * Bytes in use, spare capacity is not counted
+     */
+    return sizeof(*rowset) + rowset->num_columns * sizeof(int) +
+           rowset->num_rows * rowset->row_size + rowset->heap_size;
+}
+
+void db_rowset_free(db_rowset_t* rowset)
+{
+    if (rowset->capacity > 0)
+        api_free(rowset->pool, rowset->capacity * rowset->row_size, rowset->rows);
+
+    if (rowset->heap_capacity > 0)
+        api_free(rowset->pool, rowset->heap_capacity, rowset->heap);
+
+    if (rowset->num_columns > 0)
+        api_free(rowset->pool, rowset->num_columns * sizeof(int), rowset->types);
+
+    api_free(rowset->pool, sizeof(*rowset), rowset);
+}
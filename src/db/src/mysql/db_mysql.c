@@ -22,52 +22,462 @@
 #include "../3rdparty/shaman/sha1.h"
 #include "db_mysql.h"
 
-int db_mysql_read(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+/*
+ * Raw socket io, or compressed protocol when negotiated
+ */
+static size_t db_mysql_transport_read(db_mysql_connection_t* connection, char* buffer, size_t size)
+{
+    if (connection->store.active)
+    {
+        /*
+         * Detached connection replays stored responses
+         */
+        if (size > connection->store.size - connection->store.pos)
+            size = connection->store.size - connection->store.pos;
+
+        memcpy(buffer, connection->store.data + connection->store.pos, size);
+        connection->store.pos += size;
+
+        return size;
+    }
+
+    if (connection->compress.algorithm != DB_MYSQL_COMPRESS_NONE)
+        return db_mysql_compress_read(connection, buffer, size);
+
+    return api_stream_read(&connection->tcp.stream, buffer, size);
+}
+
+static int db_mysql_transport_write(db_mysql_connection_t* connection, const char* data, size_t size)
+{
+    if (connection->store.active)
+        return 0;
+
+    if (connection->compress.algorithm != DB_MYSQL_COMPRESS_NONE)
+        return db_mysql_compress_write(connection, data, size);
+
+    return size == api_stream_write(&connection->tcp.stream, (char*)data, size);
+}
+
+static int db_mysql_output_flush(db_mysql_connection_t* connection);
+
+static void db_mysql_retire(db_mysql_connection_t* connection, char* data, size_t size)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    db_mysql_retired_t* retired = (db_mysql_retired_t*)api_alloc(pool, sizeof(*retired));
+
+    retired->data = data;
+    retired->size = size;
+    api_list_push_tail(&connection->input.retired, (api_node_t*)retired);
+}
+
+/*
+ * Moves unconsumed bytes to fresh receive buffer, pinned one
+ * stays alive until db_mysql_release
+ */
+static void db_mysql_input_replace(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    char* data = (char*)api_alloc(pool, DB_MYSQL_INPUT_SIZE);
+
+    memcpy(data, connection->input.data + connection->input.begin,
+        connection->input.end - connection->input.begin);
+
+    db_mysql_retire(connection, connection->input.data, DB_MYSQL_INPUT_SIZE);
+
+    connection->input.data = data;
+    connection->input.end -= connection->input.begin;
+    connection->input.begin = 0;
+}
+
+/*
+ * Makes sure at least size bytes are buffered contiguously from input.begin.
+ * size must not exceed DB_MYSQL_INPUT_SIZE
+ */
+static int db_mysql_input_fill(db_mysql_connection_t* connection, size_t size)
+{
+    size_t received;
+
+    if (connection->input.data == 0)
+    {
+        connection->input.data = (char*)api_alloc(
+            api_pool_default(connection->session->base.loop), DB_MYSQL_INPUT_SIZE);
+    }
+
+    if (connection->input.pinned)
+    {
+        if (connection->input.begin + size > DB_MYSQL_INPUT_SIZE)
+            db_mysql_input_replace(connection);
+    }
+    else if (connection->input.begin == connection->input.end)
+    {
+        connection->input.begin = 0;
+        connection->input.end = 0;
+    }
+    else if (connection->input.begin + size > DB_MYSQL_INPUT_SIZE)
+    {
+        /*
+         * Packet straddles the buffer end, move its head to the front
+         */
+        memmove(connection->input.data, connection->input.data + connection->input.begin,
+            connection->input.end - connection->input.begin);
+        connection->input.end -= connection->input.begin;
+        connection->input.begin = 0;
+    }
+
+    if (connection->input.end - connection->input.begin < size && connection->output.size > 0)
+    {
+        /*
+         * Pipelined commands must reach the server before waiting for responses
+         */
+        if (!db_mysql_output_flush(connection))
+            return 0;
+    }
+
+    while (connection->input.end - connection->input.begin < size)
+    {
+        received = db_mysql_transport_read(connection,
+            connection->input.data + connection->input.end,
+            DB_MYSQL_INPUT_SIZE - connection->input.end);
+
+        if (received == 0)
+            return 0;
+
+        connection->input.end += received;
+    }
+
+    return 1;
+}
+
+/*
+ * Copies size bytes to buffer, first from already buffered ones,
+ * and the rest directly from socket
+ */
+static int db_mysql_input_take(db_mysql_connection_t* connection, char* buffer, size_t size)
+{
+    size_t buffered = connection->input.end - connection->input.begin;
+    size_t received;
+
+    if (buffered > size)
+        buffered = size;
+
+    memcpy(buffer, connection->input.data + connection->input.begin, buffered);
+    connection->input.begin += buffered;
+
+    while (buffered < size)
+    {
+        received = db_mysql_transport_read(connection, buffer + buffered, size - buffered);
+        if (received == 0)
+            return 0;
+
+        buffered += received;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads next packet header
+ */
+static int db_mysql_input_header(db_mysql_connection_t* connection, unsigned int* size, unsigned char* sequence)
 {
     int header;
+
+    if (!db_mysql_input_fill(connection, 4))
+        return 0;
+
+    header = *(int*)(connection->input.data + connection->input.begin);
+    connection->input.begin += 4;
+
+    *size = header & DB_MYSQL_MAX_PACKET;
+    *sequence = header >> 24;
+
+    return 1;
+}
+
+int db_mysql_read(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+{
     api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    unsigned int frame;
+    unsigned int allocated;
+    char* data;
+
+    packet->size = 0;
+    packet->allocated = 0;
 
     if (connection->undefined)
         return DB_UNAVAILABLE;
 
-    if (4 > api_stream_read_exact(&connection->tcp.stream, (char*)&header, 4))
+    if (!db_mysql_input_header(connection, &frame, &packet->sequence))
     {
         connection->undefined = 1;
         return DB_UNAVAILABLE;
     }
 
-    packet->size = header & 0x00ffffff;
-    packet->sequence = header >> 24;
-    packet->data = (char*)api_alloc(pool, packet->size);
+    if (frame < DB_MYSQL_MAX_PACKET && frame <= DB_MYSQL_INPUT_SIZE)
+    {
+        if (!db_mysql_input_fill(connection, frame))
+        {
+            connection->undefined = 1;
+            return DB_UNAVAILABLE;
+        }
+
+        packet->size = frame;
+        packet->data = connection->input.data + connection->input.begin;
+        connection->input.begin += frame;
+
+        return DB_OK;
+    }
+
+    /*
+     * Packet does not fit into buffer, or continues in next frames.
+     * Assemble it in allocated memory, taking already buffered part
+     * and reading the rest directly
+     */
+    while (1)
+    {
+        if (packet->size + frame > packet->allocated)
+        {
+            allocated = 2 * packet->allocated;
+            if (allocated < packet->size + frame)
+                allocated = packet->size + frame;
+
+            data = (char*)api_alloc(pool, allocated);
+
+            if (packet->allocated > 0)
+            {
+                memcpy(data, packet->data, packet->size);
+                api_free(pool, packet->allocated, packet->data);
+            }
+
+            packet->data = data;
+            packet->allocated = allocated;
+        }
+
+        if (!db_mysql_input_take(connection, packet->data + packet->size, frame))
+        {
+            db_mysql_free(connection, packet);
+            connection->undefined = 1;
+            return DB_UNAVAILABLE;
+        }
+
+        packet->size += frame;
+
+        if (frame < DB_MYSQL_MAX_PACKET)
+            return DB_OK;
+
+        if (!db_mysql_input_header(connection, &frame, &packet->sequence))
+        {
+            db_mysql_free(connection, packet);
+            connection->undefined = 1;
+            return DB_UNAVAILABLE;
+        }
+    }
+}
+
+int db_mysql_peek(db_mysql_connection_t* connection, unsigned char* code, unsigned int* size)
+{
+    int header;
+
+    if (connection->undefined)
+        return DB_UNAVAILABLE;
 
-    if (packet->size > api_stream_read_exact(&connection->tcp.stream, packet->data, packet->size))
+    if (!db_mysql_input_fill(connection, 4))
     {
-        api_free(pool, packet->size, packet->data);
         connection->undefined = 1;
         return DB_UNAVAILABLE;
     }
 
+    header = *(int*)(connection->input.data + connection->input.begin);
+    *size = header & DB_MYSQL_MAX_PACKET;
+    *code = 0;
+
+    if (*size > 0)
+    {
+        if (!db_mysql_input_fill(connection, 4 + 1))
+        {
+            connection->undefined = 1;
+            return DB_UNAVAILABLE;
+        }
+
+        *code = (unsigned char)connection->input.data[connection->input.begin + 4];
+    }
+
     return DB_OK;
 }
 
-int db_mysql_write(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+int db_mysql_read_stream(db_mysql_connection_t* connection, db_mysql_fragment_fn fn, void* arg)
 {
-    int header = packet->size | (packet->sequence << 24);
+    unsigned int frame;
+    unsigned int remaining;
+    unsigned char sequence;
+    size_t length;
 
     if (connection->undefined)
-    {
-        connection->undefined = 1;
         return DB_UNAVAILABLE;
+
+    do
+    {
+        if (!db_mysql_input_header(connection, &frame, &sequence))
+        {
+            connection->undefined = 1;
+            return DB_UNAVAILABLE;
+        }
+
+        remaining = frame;
+
+        while (remaining > 0)
+        {
+            if (!db_mysql_input_fill(connection, 1))
+            {
+                connection->undefined = 1;
+                return DB_UNAVAILABLE;
+            }
+
+            length = connection->input.end - connection->input.begin;
+            if (length > remaining)
+                length = remaining;
+
+            fn(arg, connection->input.data + connection->input.begin, length);
+
+            connection->input.begin += length;
+            remaining -= length;
+        }
+    }
+    while (frame == DB_MYSQL_MAX_PACKET);
+
+    return DB_OK;
+}
+
+/*
+ * Sends gathered output
+ */
+static int db_mysql_output_flush(db_mysql_connection_t* connection)
+{
+    size_t size = connection->output.size;
+
+    connection->output.size = 0;
+
+    if (size > 0)
+        return db_mysql_transport_write(connection, connection->output.data, size);
+
+    return 1;
+}
+
+static int db_mysql_output_append(db_mysql_connection_t* connection, const char* data, size_t size)
+{
+    if (size >= DB_MYSQL_DIRECT_SIZE)
+    {
+        /*
+         * Large pieces go to the socket from their place
+         */
+        if (!db_mysql_output_flush(connection))
+            return 0;
+
+        return db_mysql_transport_write(connection, data, size);
     }
 
-    if (4 > api_stream_write(&connection->tcp.stream, (char*)&header, 4))
+    if (connection->output.size + size > DB_MYSQL_OUTPUT_SIZE)
     {
-        connection->undefined = 1;
+        if (!db_mysql_output_flush(connection))
+            return 0;
+    }
+
+    memcpy(connection->output.data + connection->output.size, data, size);
+    connection->output.size += size;
+
+    return 1;
+}
+
+int db_mysql_write(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+{
+    db_mysql_iovec_t iov;
+
+    iov.data = packet->data;
+    iov.size = packet->size;
+
+    return db_mysql_writev(connection, packet->sequence, &iov, 1);
+}
+
+int db_mysql_writev(db_mysql_connection_t* connection, unsigned char sequence, db_mysql_iovec_t* iov, int count)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    uint64_t remaining = 0;
+    size_t frame;
+    size_t frame_left;
+    size_t offset;
+    size_t length;
+    int header;
+    int sent;
+    int i;
+
+    if (connection->undefined)
         return DB_UNAVAILABLE;
+
+    if (connection->output.data == 0)
+        connection->output.data = (char*)api_alloc(pool, DB_MYSQL_OUTPUT_SIZE);
+
+    if (sequence == 0)
+    {
+        /*
+         * New command, compressed frames are numbered from zero too
+         */
+        connection->compress.sequence = 0;
     }
 
-    if (packet->size > api_stream_write(&connection->tcp.stream, packet->data, packet->size))
+    for (i = 0; i < count; ++i)
+        remaining += iov[i].size;
+
+    /*
+     * Payload is split by frames of DB_MYSQL_MAX_PACKET bytes, payload which size
+     * is multiple of DB_MYSQL_MAX_PACKET ends up with empty frame
+     */
+    frame = remaining < DB_MYSQL_MAX_PACKET ? (size_t)remaining : DB_MYSQL_MAX_PACKET;
+    frame_left = frame;
+    header = (int)frame | (sequence++ << 24);
+
+    sent = db_mysql_output_append(connection, (char*)&header, 4);
+
+    for (i = 0; sent && i < count; ++i)
+    {
+        offset = 0;
+
+        while (sent && offset < iov[i].size)
+        {
+            if (frame_left == 0)
+            {
+                frame = remaining < DB_MYSQL_MAX_PACKET ? (size_t)remaining : DB_MYSQL_MAX_PACKET;
+                frame_left = frame;
+                header = (int)frame | (sequence++ << 24);
+
+                sent = db_mysql_output_append(connection, (char*)&header, 4);
+                if (!sent)
+                    break;
+            }
+
+            length = iov[i].size - offset;
+            if (length > frame_left)
+                length = frame_left;
+
+            sent = db_mysql_output_append(connection, iov[i].data + offset, length);
+
+            offset += length;
+            frame_left -= length;
+            remaining -= length;
+        }
+    }
+
+    if (sent && frame == DB_MYSQL_MAX_PACKET)
+    {
+        header = 0 | (sequence++ << 24);
+        sent = db_mysql_output_append(connection, (char*)&header, 4);
+    }
+
+    if (sent && !connection->output.defer)
+        sent = db_mysql_output_flush(connection);
+
+    if (!sent)
     {
+        connection->output.size = 0;
         connection->undefined = 1;
         return DB_UNAVAILABLE;
     }
@@ -79,11 +489,128 @@ void db_mysql_free(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
 {
     api_pool_t* pool = api_pool_default(connection->session->base.loop);
 
-    if (packet->size > 0)
+    if (packet->allocated > 0)
+        api_free(pool, packet->allocated, packet->data);
+
+    packet->size = 0;
+    packet->allocated = 0;
+}
+
+void db_mysql_retain(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+{
+    if (packet->allocated > 0)
     {
-        api_free(pool, packet->size, packet->data);
-        packet->size = 0;
+        /*
+         * Packet was assembled apart from receive buffer, take its ownership
+         */
+        db_mysql_retire(connection, packet->data, packet->allocated);
+    }
+    else
+    {
+        connection->input.pinned = 1;
+    }
+
+    packet->size = 0;
+    packet->allocated = 0;
+}
+
+void db_mysql_release(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    db_mysql_retired_t* retired;
+
+    while (0 != (retired = (db_mysql_retired_t*)api_list_pop_head(&connection->input.retired)))
+    {
+        api_free(pool, retired->size, retired->data);
+        api_free(pool, sizeof(*retired), retired);
+    }
+
+    connection->input.pinned = 0;
+}
+
+static void db_mysql_store_append(db_mysql_connection_t* connection, const char* data, size_t size)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    size_t capacity = connection->store.capacity;
+    char* buffer;
+
+    if (connection->store.size + size > capacity)
+    {
+        capacity = capacity > 0 ? 2 * capacity : DB_MYSQL_INPUT_SIZE;
+        if (capacity < connection->store.size + size)
+            capacity = connection->store.size + size;
+
+        buffer = (char*)api_alloc(pool, capacity);
+
+        if (connection->store.capacity > 0)
+        {
+            memcpy(buffer, connection->store.data, connection->store.size);
+            api_free(pool, connection->store.capacity, connection->store.data);
+        }
+
+        connection->store.data = buffer;
+        connection->store.capacity = capacity;
+    }
+
+    memcpy(connection->store.data + connection->store.size, data, size);
+    connection->store.size += size;
+}
+
+void db_mysql_store_packet(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+{
+    unsigned char sequence = packet->sequence;
+    const char* data = packet->data;
+    size_t size = packet->size;
+    size_t frame;
+    int header;
+
+    /*
+     * Same framing as on the wire, so that stored packets are read back
+     * by db_mysql_read
+     */
+    do
+    {
+        frame = size < DB_MYSQL_MAX_PACKET ? size : DB_MYSQL_MAX_PACKET;
+        header = (int)frame | (sequence++ << 24);
+
+        db_mysql_store_append(connection, (const char*)&header, 4);
+        db_mysql_store_append(connection, data, frame);
+
+        data += frame;
+        size -= frame;
     }
+    while (frame == DB_MYSQL_MAX_PACKET);
+}
+
+void db_mysql_store_free(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+
+    if (connection->store.capacity > 0)
+        api_free(pool, connection->store.capacity, connection->store.data);
+
+    memset(&connection->store, 0, sizeof(connection->store));
+}
+
+void db_mysql_buffers_free(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+
+    db_mysql_release(connection);
+
+    if (connection->input.data != 0)
+        api_free(pool, DB_MYSQL_INPUT_SIZE, connection->input.data);
+
+    if (connection->output.data != 0)
+        api_free(pool, DB_MYSQL_OUTPUT_SIZE, connection->output.data);
+
+    connection->input.data = 0;
+    connection->input.begin = 0;
+    connection->input.end = 0;
+    connection->output.data = 0;
+    connection->output.size = 0;
+
+    db_mysql_compress_free(connection);
 }
 
 uint64_t db_mysql_read_lenencint(char* buffer, uint64_t* count)
@@ -104,13 +631,13 @@ uint64_t db_mysql_read_lenencint(char* buffer, uint64_t* count)
     else
     if (value == 0xfd)
     {
-        value = 4 + 0x00ffffff & *(int*)(buffer + 1);
+        value = 0x00ffffff & *(int*)(buffer + 1);
         *count = 4;
     }
     else
     if (value == 0xfe)
     {
-        value = 9 + *(uint64_t*)(buffer + 1);
+        value = *(uint64_t*)(buffer + 1);
         *count = 9;
     }
     else
@@ -345,6 +872,94 @@ int db_mysql_detect_type(unsigned char mysql_type)
     return DB_TYPE_BINARY;
 }
 
+/*
+ * Answers request of LOAD DATA LOCAL INFILE by content of file, packets follow
+ * the request in sequence and end up with empty one. Only file given to
+ * db_mysql_connection_load is sent, others get empty content
+ */
+static int db_mysql_send_infile(db_mysql_connection_t* connection, db_mysql_packet_t* packet)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    unsigned char sequence = packet->sequence + 1;
+    const char* name = connection->infile.name;
+    db_mysql_iovec_t iov;
+    char* chunk = 0;
+    size_t size;
+    int matched;
+    int done = 0;
+    int count;
+    int code = DB_OK;
+
+    matched = connection->infile.fn != 0 && name != 0 &&
+        packet->size - 1 == strlen(name) &&
+        0 == memcmp(packet->data + 1, name, packet->size - 1);
+
+    db_mysql_free(connection, packet);
+
+    connection->output.defer = 1;
+
+    if (matched)
+    {
+        chunk = (char*)api_alloc(pool, DB_MYSQL_LONG_DATA_SIZE);
+
+        while (DB_OK == code && !done)
+        {
+            /*
+             * Fill up whole chunk, to not send many small packets
+             * when source produces data by small pieces
+             */
+            size = 0;
+            while (size < DB_MYSQL_LONG_DATA_SIZE)
+            {
+                count = connection->infile.fn(connection->infile.arg, chunk + size, DB_MYSQL_LONG_DATA_SIZE - size);
+                if (count <= 0)
+                {
+                    if (count < 0)
+                        code = DB_FAILED;
+
+                    done = 1;
+                    break;
+                }
+
+                size += count;
+            }
+
+            if (DB_OK == code && size > 0)
+            {
+                iov.data = chunk;
+                iov.size = size;
+                code = db_mysql_writev(connection, sequence++, &iov, 1);
+            }
+        }
+
+        api_free(pool, DB_MYSQL_LONG_DATA_SIZE, chunk);
+    }
+
+    if (DB_OK == code)
+    {
+        iov.data = 0;
+        iov.size = 0;
+        code = db_mysql_writev(connection, sequence, &iov, 1);
+    }
+
+    connection->output.defer = 0;
+
+    if (DB_FAILED == code)
+    {
+        /*
+         * Empty packet would commit rows loaded so far, instead connection
+         * is dropped, so that server aborts the statement
+         */
+        connection->undefined = 1;
+        return DB_FAILED;
+    }
+
+    if (DB_OK == code && !matched)
+        return DB_MISMATCH;
+
+    return code;
+}
+
 /*
  * Tryes to read first result packet after query, or exec.
  * If resultset available initializes connection.result field,
@@ -356,6 +971,7 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id)
     db_mysql_result_t* result;
     db_mysql_packet_t packet;
     uint64_t pos = 0;
+    int infile = DB_OK;
     int code = 0;
 
     /*
@@ -373,13 +989,27 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id)
     if (DB_OK != code)
         return code;
 
-    else if (PACKET_IS_ERROR(packet))
+    if (PACKET_IS_LOCAL_INFILE(packet))
+    {
+        /*
+         * Server asks for file of LOAD DATA LOCAL INFILE, OK or ERR follows its content
+         */
+        infile = db_mysql_send_infile(connection, &packet);
+        if (DB_OK != infile && DB_MISMATCH != infile)
+            return infile;
+
+        code = db_mysql_read(connection, &packet);
+        if (DB_OK != code)
+            return code;
+    }
+
+    if (PACKET_IS_ERROR(packet))
     {
         /*
          * On failure, set error status in connection and exit
          */
         db_mysql_parse_error(pool, &packet, &connection->error);
-        db_mysql_free(result->connection, &packet);
+        db_mysql_free(connection, &packet);
         return DB_FAILED;
     }
 
@@ -392,7 +1022,11 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id)
         connection->insert_id = db_mysql_read_lenencint(packet.data + 1 + pos, &pos);
 
         db_mysql_free(connection, &packet);
-        return DB_OK;
+
+        /*
+         * Refused file was taken as empty one
+         */
+        return infile;
     }
     else
     {
@@ -400,6 +1034,9 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id)
          * Read Columns Count
          */
         connection->result = (db_mysql_result_t*)api_calloc(pool, sizeof(*result));
+        db_arena_init(&connection->result->meta, pool, DB_MYSQL_META_ARENA);
+        db_arena_init(&connection->result->arena, pool, DB_MYSQL_ROWS_ARENA);
+        db_arena_init(&connection->result->spare, pool, DB_MYSQL_ROWS_ARENA);
         connection->result->connection = connection;
         connection->result->statement_id = statement_id;
         connection->result->num_columns = (int)db_mysql_read_lenencint(packet.data, &pos);
@@ -407,4 +1044,48 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id)
 
         return DB_OK;
     }
+}
+
+void db_mysql_pipeline_push(db_mysql_connection_t* connection, int statement_id)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    db_mysql_command_t* command = (db_mysql_command_t*)api_alloc(pool, sizeof(*command));
+
+    command->statement_id = statement_id;
+    api_list_push_tail(&connection->pipeline, (api_node_t*)command);
+}
+
+int db_mysql_pipeline_pop(db_mysql_connection_t* connection, int* statement_id)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    db_mysql_command_t* command = (db_mysql_command_t*)api_list_pop_head(&connection->pipeline);
+
+    if (command == 0)
+        return 0;
+
+    *statement_id = command->statement_id;
+    api_free(pool, sizeof(*command), command);
+
+    return 1;
+}
+
+int db_mysql_sync(db_mysql_connection_t* connection)
+{
+    int statement_id;
+
+    db_mysql_eat_result(connection);
+
+    while (db_mysql_pipeline_pop(connection, &statement_id))
+    {
+        /*
+         * On broken connection just forget the rest
+         */
+        if (!connection->undefined)
+        {
+            db_mysql_read_result(connection, statement_id);
+            db_mysql_eat_result(connection);
+        }
+    }
+
+    return connection->undefined ? DB_UNAVAILABLE : DB_OK;
 }
\ No newline at end of file
@@ -50,6 +50,12 @@
 #define CLIENT_MULTI_STATEMENTS (1UL << 16) /* Enable/disable multi-stmt support */
 #define CLIENT_MULTI_RESULTS    (1UL << 17) /* Enable/disable multi-results */
 #define CLIENT_PS_MULTI_RESULTS (1UL << 18) /* Multi-results in PS-protocol */
+#define CLIENT_ZSTD_COMPRESSION_ALGORITHM (1UL << 26) /* Can use zstd compression protocol */
+
+/*
+ * MariaDB extended capabilities, sent when server clears CLIENT_LONG_PASSWORD
+ */
+#define MARIADB_CLIENT_STMT_BULK_OPERATIONS (1UL << 2) /* COM_STMT_BULK_EXECUTE */
 
 // http://my.safaribooksonline.com/0596009577/orm9780596009571-chp-4-sect-5
 
@@ -72,6 +78,7 @@
 #define COM_STMT_RESET      26 /* Reset statement */
 #define COM_SET_OPTION      27 /* Enable/disable multiple statements in query */
 #define COM_STMT_FETCH      28 /* Fetcha data from statement */
+#define COM_STMT_BULK_EXECUTE 250 /* MariaDB, execute statement for array of params */
 
 //http://dev.mysql.com/doc/internals/en/status-flags.html
 
@@ -88,8 +95,81 @@
 #define SERVER_QUERY_WAS_SLOW               0x0800
 #define SERVER_PS_OUT_PARAMS                0x1000
 
+/*
+ * COM_STMT_EXECUTE flags
+ */
+#define CURSOR_TYPE_NO_CURSOR   0
+#define CURSOR_TYPE_READ_ONLY   1
+
+/*
+ * COM_STMT_BULK_EXECUTE flags and per value indicators
+ */
+#define STMT_BULK_FLAG_SEND_TYPES_TO_SERVER 128
+#define STMT_INDICATOR_NONE     0
+#define STMT_INDICATOR_NULL     1
+
+/*
+ * Size of per connection receive buffer
+ */
+#define DB_MYSQL_INPUT_SIZE     (64 * 1024)
+
+/*
+ * Size of per connection send buffer, and the size starting from which
+ * payload pieces are written to socket directly instead of being buffered
+ */
+#define DB_MYSQL_OUTPUT_SIZE    (16 * 1024)
+#define DB_MYSQL_DIRECT_SIZE    (4 * 1024)
+
+/*
+ * How parameter is laid out in COM_STMT_EXECUTE
+ */
+#define DB_MYSQL_SLOT_NULL      0
+#define DB_MYSQL_SLOT_VALUE     1
+#define DB_MYSQL_SLOT_LONG_DATA 2
+
+/*
+ * Max payload of single packet, larger payloads are split by several packets
+ */
+#define DB_MYSQL_MAX_PACKET     0x00ffffff
+
+/*
+ * Max chunk of parameter value sent by single COM_STMT_SEND_LONG_DATA,
+ * keeps streamed values far below server max_allowed_packet
+ */
+#define DB_MYSQL_LONG_DATA_SIZE (256 * 1024)
+
+/*
+ * Compressed protocol, payloads shorter than DB_MYSQL_MIN_COMPRESS are sent as is
+ */
+#define DB_MYSQL_COMPRESS_NONE  0
+#define DB_MYSQL_COMPRESS_ZLIB  1
+#define DB_MYSQL_COMPRESS_ZSTD  2
+#define DB_MYSQL_MIN_COMPRESS   50
+#define DB_MYSQL_ZSTD_LEVEL     3
+
+/*
+ * Chunk sizes of per result arenas, for column definitions and for rows
+ */
+#define DB_MYSQL_META_ARENA     (4 * 1024)
+#define DB_MYSQL_ROWS_ARENA     (64 * 1024)
+#define DB_MYSQL_FETCH_SIZE     (64 * 1024) // bytes per COM_STMT_FETCH by default
+#define DB_MYSQL_AHEAD_STACK    (32 * 1024) // read ahead fiber, see db_mysql_result_fetch_rows
+
+/*
+ * Limits of db_mysql_statement_exec_batch, payload bytes per COM_STMT_BULK_EXECUTE
+ * and pipelined COM_STMT_EXECUTE commands sent before their responses are read
+ */
+#define DB_MYSQL_BULK_SIZE      (1024 * 1024)
+#define DB_MYSQL_BATCH_WINDOW   256
+
+/*
+ * Max null bitmap size of binary protocol row, server allows up to 4096 columns
+ */
+#define DB_MYSQL_MAX_BITMAP     ((4096 + 7 + 2) / 8)
+
 #define PACKET_OK       0
 #define PACKET_EOF      0xfe
+#define PACKET_LOCAL_INFILE 0xfb
 #define PACKET_ERROR    0xff
 
 #define MYSQL_TYPE_DECIMAL      0x00    /* lenenc string */
@@ -127,8 +207,26 @@ typedef struct db_mysql_packet_t {
     unsigned int size;
     unsigned char sequence;
     char* data;
+    /*
+     * Bytes allocated for payload by api_alloc, if 0 then data points into
+     * connection's receive buffer and is valid until the next read
+     */
+    unsigned int allocated;
 } db_mysql_packet_t;
 
+/*
+ * Receives packet payload by fragments
+ */
+typedef void (*db_mysql_fragment_fn)(void* arg, char* data, size_t length);
+
+/*
+ * Piece of packet payload for gathered writes
+ */
+typedef struct db_mysql_iovec_t {
+    const char* data;
+    size_t size;
+} db_mysql_iovec_t;
+
 typedef struct db_mysql_status_t {
     int code;
     union {
@@ -147,6 +245,25 @@ typedef struct db_mysql_status_t {
     };
 } db_mysql_status_t;
 
+/*
+ * Command sent in pipeline which response is not read yet
+ */
+typedef struct db_mysql_command_t {
+    struct db_mysql_command_t* next;
+    struct db_mysql_command_t* prev;
+    int statement_id;
+} db_mysql_command_t;
+
+/*
+ * Receive buffer or assembled packet kept alive by db_mysql_retain
+ */
+typedef struct db_mysql_retired_t {
+    struct db_mysql_retired_t* next;
+    struct db_mysql_retired_t* prev;
+    char* data;
+    size_t size;
+} db_mysql_retired_t;
+
 typedef struct db_mysql_session_t {
     db_session_t base;
     char* username;
@@ -155,9 +272,13 @@ typedef struct db_mysql_session_t {
     char* ip;
     int port;
     int flags;
+    uint64_t abort_threshold; // see db_engine_t
+    uint64_t read_ahead; // see db_engine_t
+    uint64_t fetch_size; // see db_engine_t
     struct {
         int version;
         int capabilities;
+        int mariadb_capabilities;
         int charset;
         int low_version;
         int auth_failed;
@@ -178,6 +299,64 @@ typedef struct db_mysql_connection_t {
      * ToDo: add support to pipe, and shared memory
      */
     api_tcp_t tcp;
+    uint32_t thread_id; // server side connection id, from handshake
+    /*
+     * Receive buffer, socket is read by large chunks and packets
+     * are handed out as views into it
+     */
+    struct {
+        char* data;
+        size_t begin; // first unconsumed byte
+        size_t end; // end of received bytes
+        int pinned; // handed out packets are still referenced, data must not move
+        api_list_t retired; // buffers replaced while pinned
+    } input;
+    /*
+     * Send buffer, small payload pieces are gathered here
+     * to go out by a single write
+     */
+    struct {
+        char* data;
+        size_t size;
+        int defer; // gather pipelined commands, flush on next read
+    } output;
+    /*
+     * Compressed protocol state, wraps reads and writes of both buffers above
+     */
+    struct {
+        int algorithm; // DB_MYSQL_COMPRESS_*
+        unsigned char sequence;
+        unsigned int raw; // bytes left of current not compressed frame
+        char* packed; // compressed frame
+        size_t packed_size;
+        char* data; // decompressed frame
+        size_t data_size;
+        size_t begin;
+        size_t end;
+    } compress;
+    /*
+     * Stored responses of detached connection, replayed instead of socket
+     */
+    struct {
+        int active;
+        char* data;
+        size_t size;
+        size_t capacity;
+        size_t pos; // replayed bytes
+        struct db_mysql_connection_t* origin; // cursor batches are fetched through
+    } store;
+    /*
+     * Pipelined commands, responses are read in FIFO order
+     */
+    api_list_t pipeline;
+    /*
+     * Source of LOAD DATA LOCAL INFILE, see db_mysql_connection_load
+     */
+    struct {
+        const char* name; // only file server may ask for
+        db_read_fn fn;
+        void* arg;
+    } infile;
     uint64_t affected;
     uint64_t insert_id;
     /*
@@ -187,6 +366,15 @@ typedef struct db_mysql_connection_t {
     int undefined;
 } db_mysql_connection_t;
 
+/*
+ * Place of parameter value in COM_STMT_EXECUTE buffer
+ */
+typedef struct db_mysql_slot_t {
+    size_t offset;
+    uint64_t length; // value size of strings, encoded bytes of others
+    char state; // DB_MYSQL_SLOT_*
+} db_mysql_slot_t;
+
 typedef struct db_mysql_statement_t {
     /*
      * Must be binary compatible with db_statement_t
@@ -201,9 +389,50 @@ typedef struct db_mysql_statement_t {
     db_column_t* params;
     db_value_t* values;
     int* mysql_types;
-    int params_changed;
+    char* long_data; // value was sent by COM_STMT_SEND_LONG_DATA
+    char* by_ref; // value points to caller's memory, see db_mysql_statement_bind_ref
+    char* changed; // value is not yet written to exec.data
+    int types_changed; // types are sent by next execution
+    int layout_changed; // exec.data is laid out again by next execution
+    int cursor; // CURSOR_TYPE_* of next execution
+
+    /*
+     * COM_STMT_EXECUTE kept between executions, see db_mysql_statement_send_command
+     */
+    struct {
+        char* data;
+        size_t size;
+        size_t capacity;
+        db_mysql_slot_t* slots;
+        int num_direct; // values sent from their place
+    } exec;
 } db_mysql_statement_t;
 
+/*
+ * Decodes single value of row, returns bytes count consumed
+ */
+typedef uint64_t (*db_mysql_decode_fn)(db_arena_t* arena, char* buffer, db_value_t* value);
+
+/*
+ * How column values of resultset rows are decoded
+ */
+typedef struct db_mysql_column_plan_t {
+    db_mysql_decode_fn decode;
+    int null_byte; // null bitmap byte and bit of binary protocol
+    int null_shift;
+    int offset; // value offset in binary row without nulls, valid when all columns are fixed size
+} db_mysql_column_plan_t;
+
+/*
+ * Writes value into caller's memory, see db_mysql_result_bind
+ */
+typedef void (*db_mysql_store_fn)(db_binding_t* binding, char* dest, db_value_t* value, int type);
+
+typedef struct db_mysql_bound_t {
+    db_binding_t binding;
+    db_mysql_store_fn store; // 0 for skipped column
+} db_mysql_bound_t;
+
 typedef struct db_mysql_result_t {
     /*
      * Must be binary compatible with db_result_t
@@ -222,8 +451,53 @@ typedef struct db_mysql_result_t {
     int by_fetch; // fetch rows by COM_STMT_FETCH
     int rows_done; // all rows was fetched in current resultset
     int statement_id;
+    int columns_ready; // columns of cursor was read on execution
+    struct {
+        int pending; // COM_STMT_FETCH was sent, its rows are not read up to EOF
+        uint64_t rows; // rows received from cursor
+        uint64_t bytes; // and their size, to size next fetch
+    } fetch;
+    db_mysql_column_plan_t* plan; // built by fetch_columns
+    int bitmap_size; // binary protocol null bitmap size
+    int all_fixed; // binary protocol rows without nulls have fixed layout
+    int zero_copy; // strings reference packets, see DB_MYSQL_ZERO_COPY
+    db_value_t* row; // row reused by db_mysql_result_next_row and db_mysql_result_fetch_bound
+    db_mysql_bound_t* bound; // caller's destinations of current resultset
+    db_mysql_column_plan_t* bound_plan; // decodes without copying, values are copied by bound
+    uint64_t skipped; // row bytes dropped by close, see abort_threshold
+    int aborted; // query was killed, rest of rows are skipped regardless of threshold
+    db_arena_t meta; // columns of current resultset
+    db_arena_t arena; // rows of current batch
+    /*
+     * Next batch of db_mysql_result_fetch_rows is read by helper fiber
+     * into arena, while rows of current one are kept in spare
+     */
+    db_arena_t spare;
+    struct {
+        int running;
+        int code;
+        int count; // rows to read
+        int num_rows; // rows read
+        api_list_t list; // db_mysql_row_node_t
+        api_event_t done;
+    } ahead;
 } db_mysql_result_t;
 
+typedef struct db_mysql_row_t {
+    /*
+     * Must be binary compatible with db_row_t
+     */
+    db_mysql_result_t* result;
+
+    /*
+     * MySQL specific
+     */
+    char* data; // raw row packet
+    uint32_t* offsets; // value offsets, built on first access
+    int indexed; // count of columns which offsets are known
+    uint32_t cursor; // offset of first not indexed column
+} db_mysql_row_t;
+
 /*
  * Macro
  */
@@ -231,6 +505,7 @@ typedef struct db_mysql_result_t {
 #define PACKET_IS_OK(packet) (PACKET_OK == (unsigned char)*(packet).data)
 #define PACKET_IS_EOF(packet) ((packet).size < 9 && PACKET_EOF == (unsigned char)*(packet).data)
 #define PACKET_IS_ERROR(packet) (PACKET_ERROR == (unsigned char)*(packet).data)
+#define PACKET_IS_LOCAL_INFILE(packet) (PACKET_LOCAL_INFILE == (unsigned char)*(packet).data)
 
 /*
  * Helpers
@@ -238,12 +513,32 @@ typedef struct db_mysql_result_t {
 
 /*
  * Reads packet from connection.
+ * Packet data points into connection's receive buffer when fits in it,
+ * so it must be consumed before the next read.
  * Returns:
  *   DB_OK on success, call db_mysql_free after use
  *   DB_UNAVAILABLE on failure, and sets connection.undefined to 1
  */
 int db_mysql_read(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
 
+/*
+ * Returns first payload byte and size of next packet without consuming it.
+ * For packets split by several frames size is DB_MYSQL_MAX_PACKET.
+ * Returns:
+ *   DB_OK on success
+ *   DB_UNAVAILABLE on failure, and sets connection.undefined to 1
+ */
+int db_mysql_peek(db_mysql_connection_t* connection, unsigned char* code, unsigned int* size);
+
+/*
+ * Reads packet from connection passing its payload to fn by fragments
+ * as they arrive, without assembling it in memory.
+ * Returns:
+ *   DB_OK on success
+ *   DB_UNAVAILABLE on failure, and sets connection.undefined to 1
+ */
+int db_mysql_read_stream(db_mysql_connection_t* connection, db_mysql_fragment_fn fn, void* arg);
+
 /*
  * Sends packet to connection.
  * Returns:
@@ -252,11 +547,71 @@ int db_mysql_read(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
  */
 int db_mysql_write(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
 
+/*
+ * Sends single packet which payload is concatenation of count pieces,
+ * payloads larger than DB_MYSQL_MAX_PACKET are split by several packets.
+ * Header and small pieces are gathered into connection's send buffer,
+ * large pieces are written from their place without copying.
+ * Returns:
+ *   DB_OK on success
+ *   DB_UNAVAILABLE on failure, and sets connection.undefined to 1
+ */
+int db_mysql_writev(db_mysql_connection_t* connection, unsigned char sequence, db_mysql_iovec_t* iov, int count);
+
+/*
+ * Returns DB_MYSQL_COMPRESS_* algorithm supported by both sides
+ * if compression was requested in session flags
+ */
+int db_mysql_compress_negotiate(db_mysql_session_t* session);
+
+/*
+ * Reads up to size decompressed bytes into buffer.
+ * Returns bytes count read, 0 on failure
+ */
+size_t db_mysql_compress_read(db_mysql_connection_t* connection, char* buffer, size_t size);
+
+/*
+ * Sends data by compressed frames.
+ * Returns 1 on success, 0 on failure
+ */
+int db_mysql_compress_write(db_mysql_connection_t* connection, const char* data, size_t size);
+
+/*
+ * Free compressed protocol buffers
+ */
+void db_mysql_compress_free(db_mysql_connection_t* connection);
+
+/*
+ * Parse numbers of text protocol rows. Integers saturate on overflow,
+ * floating point values are correctly rounded
+ */
+int64_t db_mysql_parse_integer(const char* buffer, int length);
+double db_mysql_parse_double(const char* buffer, int length);
+float db_mysql_parse_float(const char* buffer, int length);
+
+/*
+ * Appends packet to stored responses, see db_mysql_result_store
+ */
+void db_mysql_store_packet(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
+void db_mysql_store_free(db_mysql_connection_t* connection);
+
+/*
+ * Keeps packet memory valid until db_mysql_release, used for values
+ * referencing packets in place
+ */
+void db_mysql_retain(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
+void db_mysql_release(db_mysql_connection_t* connection);
+
 /*
  * Free packet payload
  */
 void db_mysql_free(db_mysql_connection_t* connection, db_mysql_packet_t* packet);
 
+/*
+ * Free connection's receive and send buffers
+ */
+void db_mysql_buffers_free(db_mysql_connection_t* connection);
+
 /*
  * Read and return uint64_t encoded as lenenc
  * Params:
@@ -327,6 +682,23 @@ int db_mysql_read_result(db_mysql_connection_t* connection, int statement_id);
  */
 int db_mysql_eat_result(db_mysql_connection_t* connection);
 
+/*
+ * Queue command which response will be read later
+ */
+void db_mysql_pipeline_push(db_mysql_connection_t* connection, int statement_id);
+
+/*
+ * Dequeue oldest pipelined command.
+ * Returns 0 if pipeline is empty
+ */
+int db_mysql_pipeline_pop(db_mysql_connection_t* connection, int* statement_id);
+
+/*
+ * Eats current resultsets and responses of all pipelined commands,
+ * call before sending command which response is read immediately
+ */
+int db_mysql_sync(db_mysql_connection_t* connection);
+
 /*
  * Interface declarations
  */
@@ -339,6 +711,8 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
 int db_mysql_connection_open(db_mysql_session_t* session, db_mysql_connection_t** connection);
 int db_mysql_connection_error(db_mysql_connection_t* connection, db_error_t* error);
 int db_mysql_connection_query(db_mysql_connection_t* connection, const char* sql, db_mysql_result_t** result);
+int db_mysql_connection_send_query(db_mysql_connection_t* connection, const char* sql);
+int db_mysql_connection_read_result(db_mysql_connection_t* connection, db_mysql_result_t** result);
 int db_mysql_connection_affected(db_mysql_connection_t* connection, uint64_t* affected);
 int db_mysql_connection_insert_id(db_mysql_connection_t* connection, uint64_t* insert_id);
 int db_mysql_connection_begin(db_mysql_connection_t* connection);
@@ -364,11 +738,45 @@ int db_mysql_statement_bind_timestamp(db_mysql_statement_t* statement, int index
 int db_mysql_statement_bind_string(db_mysql_statement_t* statement, int index, const char* value);
 int db_mysql_statement_bind_binary(db_mysql_statement_t* statement, int index, void* value, uint64_t size);
 int db_mysql_statement_bind_blob(db_mysql_statement_t* statement, int index, void* value, uint64_t size);
+int db_mysql_statement_bind_stream(db_mysql_statement_t* statement, int index, db_read_fn fn, void* arg);
+int db_mysql_statement_bind_ref(db_mysql_statement_t* statement, int index, const void* value, uint64_t size);
+int db_mysql_statement_bind_struct(db_mysql_statement_t* statement, db_param_t* params, int count, const void* base);
 int db_mysql_statement_exec(db_mysql_statement_t* statement, db_mysql_result_t** result);
+int db_mysql_statement_exec_cursor(db_mysql_statement_t* statement, db_mysql_result_t** result);
+int db_mysql_statement_exec_batch(db_mysql_statement_t* statement, db_binding_t* bindings, int count, uint64_t rows);
+int db_mysql_statement_send_exec(db_mysql_statement_t* statement);
 int db_mysql_statement_close(db_mysql_statement_t* statement);
 
 int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** columns, int* num_columns);
 int db_mysql_result_fetch_rows(db_mysql_result_t* result, db_value_t*** rows, int* count);
+int db_mysql_result_fetch_lazy(db_mysql_result_t* result, db_mysql_row_t*** rows, int* count);
+int db_mysql_result_fetch_rowset(db_mysql_result_t* result, db_rowset_t** rowset, int* count);
+int db_mysql_result_fetch_vectors(db_mysql_result_t* result, db_vector_t** vectors, int* count);
+int db_mysql_result_next_row(db_mysql_result_t* result, db_value_t** row);
+int db_mysql_result_bind(db_mysql_result_t* result, db_binding_t* bindings, int count);
+int db_mysql_result_fetch_bound(db_mysql_result_t* result, int* count);
+int db_mysql_result_fetch_each(db_mysql_result_t* result, db_row_fn fn, void* arg);
+int db_mysql_result_fetch_stream(db_mysql_result_t* result, int column, db_write_fn fn, void* arg, int* is_null);
+int db_mysql_result_store(db_mysql_result_t* result);
+/*
+ * Reads columns of cursor and releases connection, so that several
+ * cursors can be fetched by turns
+ */
+int db_mysql_result_open_cursor(db_mysql_result_t* result);
+/*
+ * Waits for read ahead of next batch, must precede any other read of result
+ */
+void db_mysql_result_join(db_mysql_result_t* result);
+/*
+ * Stops query running on connection, by KILL QUERY sent from another one
+ */
+int db_mysql_connection_kill_query(db_mysql_connection_t* connection);
+/*
+ * Runs LOAD DATA LOCAL INFILE query, content of named file is produced by fn
+ */
+int db_mysql_connection_load(db_mysql_connection_t* connection, const char* sql, const char* name, db_read_fn fn, void* arg);
 int db_mysql_result_close(db_mysql_result_t* result);
 
+int db_mysql_row_get(db_mysql_row_t* row, int column, db_value_t* value);
+
 #endif // DB_MYSQL_H_INCLUDED
\ No newline at end of file
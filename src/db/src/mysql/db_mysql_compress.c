@@ -0,0 +1,274 @@
+/* Copyright (c) 2014, Artak Khnkoyan <artak.khnkoyan@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Compressed protocol, see
+ * http://dev.mysql.com/doc/internals/en/compressed-packet-header.html
+ *
+ * Build with DB_WITH_ZLIB and/or DB_WITH_ZSTD to enable algorithms
+ */
+
+#ifdef DB_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef DB_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "db_mysql.h"
+
+/*
+ * Grows buffer to at least size bytes, contents are not preserved
+ */
+static void db_mysql_compress_reserve(api_pool_t* pool, char** buffer, size_t* capacity, size_t size)
+{
+    if (*capacity >= size)
+        return;
+
+    if (*capacity > 0)
+        api_free(pool, *capacity, *buffer);
+
+    *buffer = (char*)api_alloc(pool, size);
+    *capacity = size;
+}
+
+static size_t db_mysql_compress_bound(int algorithm, size_t size)
+{
+    switch (algorithm)
+    {
+#ifdef DB_WITH_ZLIB
+    case DB_MYSQL_COMPRESS_ZLIB:
+        return compressBound((uLong)size);
+#endif
+#ifdef DB_WITH_ZSTD
+    case DB_MYSQL_COMPRESS_ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    }
+
+    return size;
+}
+
+/*
+ * Returns compressed size, or 0 if data can not be compressed into dst
+ */
+static size_t db_mysql_compress_pack(int algorithm, char* dst, size_t capacity, const char* src, size_t size)
+{
+#ifdef DB_WITH_ZLIB
+    uLongf length;
+#endif
+#ifdef DB_WITH_ZSTD
+    size_t code;
+#endif
+
+    switch (algorithm)
+    {
+#ifdef DB_WITH_ZLIB
+    case DB_MYSQL_COMPRESS_ZLIB:
+        length = (uLongf)capacity;
+        if (Z_OK != compress((Bytef*)dst, &length, (const Bytef*)src, (uLong)size))
+            return 0;
+        return (size_t)length;
+#endif
+#ifdef DB_WITH_ZSTD
+    case DB_MYSQL_COMPRESS_ZSTD:
+        code = ZSTD_compress(dst, capacity, src, size, DB_MYSQL_ZSTD_LEVEL);
+        if (ZSTD_isError(code))
+            return 0;
+        return code;
+#endif
+    }
+
+    return 0;
+}
+
+/*
+ * Returns 1 if src was decompressed into exactly size bytes of dst
+ */
+static int db_mysql_compress_unpack(int algorithm, char* dst, size_t size, const char* src, size_t length)
+{
+#ifdef DB_WITH_ZLIB
+    uLongf unpacked;
+#endif
+
+    switch (algorithm)
+    {
+#ifdef DB_WITH_ZLIB
+    case DB_MYSQL_COMPRESS_ZLIB:
+        unpacked = (uLongf)size;
+        return Z_OK == uncompress((Bytef*)dst, &unpacked, (const Bytef*)src, (uLong)length) && unpacked == size;
+#endif
+#ifdef DB_WITH_ZSTD
+    case DB_MYSQL_COMPRESS_ZSTD:
+        return size == ZSTD_decompress(dst, size, src, length);
+#endif
+    }
+
+    return 0;
+}
+
+int db_mysql_compress_negotiate(db_mysql_session_t* session)
+{
+    if (0 == (session->flags & DB_MYSQL_COMPRESS))
+        return DB_MYSQL_COMPRESS_NONE;
+
+#ifdef DB_WITH_ZSTD
+    if (0 != (session->server.capabilities & CLIENT_ZSTD_COMPRESSION_ALGORITHM))
+        return DB_MYSQL_COMPRESS_ZSTD;
+#endif
+
+#ifdef DB_WITH_ZLIB
+    if (0 != (session->server.capabilities & CLIENT_COMPRESS))
+        return DB_MYSQL_COMPRESS_ZLIB;
+#endif
+
+    return DB_MYSQL_COMPRESS_NONE;
+}
+
+size_t db_mysql_compress_read(db_mysql_connection_t* connection, char* buffer, size_t size)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    unsigned char header[7];
+    size_t packed;
+    size_t unpacked;
+    size_t length;
+
+    while (connection->compress.begin == connection->compress.end && connection->compress.raw == 0)
+    {
+        /*
+         * Read next frame header:
+         * [3 bytes compressed length][sequence][3 bytes uncompressed length]
+         */
+        if (7 != api_stream_read_exact(&connection->tcp.stream, (char*)header, 7))
+            return 0;
+
+        packed = header[0] | (header[1] << 8) | (header[2] << 16);
+        connection->compress.sequence = header[3] + 1;
+        unpacked = header[4] | (header[5] << 8) | (header[6] << 16);
+
+        if (unpacked == 0)
+        {
+            /*
+             * Frame is not compressed, read it directly into caller's buffer
+             */
+            connection->compress.raw = (unsigned int)packed;
+            continue;
+        }
+
+        db_mysql_compress_reserve(pool, &connection->compress.packed, &connection->compress.packed_size, packed);
+        db_mysql_compress_reserve(pool, &connection->compress.data, &connection->compress.data_size, unpacked);
+
+        if (packed != api_stream_read_exact(&connection->tcp.stream, connection->compress.packed, packed))
+            return 0;
+
+        if (!db_mysql_compress_unpack(connection->compress.algorithm,
+                connection->compress.data, unpacked, connection->compress.packed, packed))
+            return 0;
+
+        connection->compress.begin = 0;
+        connection->compress.end = unpacked;
+    }
+
+    if (connection->compress.raw > 0)
+    {
+        length = size < connection->compress.raw ? size : connection->compress.raw;
+        length = api_stream_read(&connection->tcp.stream, buffer, length);
+        connection->compress.raw -= (unsigned int)length;
+
+        return length;
+    }
+
+    length = connection->compress.end - connection->compress.begin;
+    if (length > size)
+        length = size;
+
+    memcpy(buffer, connection->compress.data + connection->compress.begin, length);
+    connection->compress.begin += length;
+
+    return length;
+}
+
+int db_mysql_compress_write(db_mysql_connection_t* connection, const char* data, size_t size)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    unsigned char* header;
+    size_t length;
+    size_t packed;
+    size_t unpacked;
+
+    while (size > 0)
+    {
+        length = size < DB_MYSQL_MAX_PACKET ? size : DB_MYSQL_MAX_PACKET;
+
+        db_mysql_compress_reserve(pool, &connection->compress.packed, &connection->compress.packed_size,
+            7 + db_mysql_compress_bound(connection->compress.algorithm, length));
+
+        packed = 0;
+        unpacked = length;
+
+        if (length >= DB_MYSQL_MIN_COMPRESS)
+        {
+            packed = db_mysql_compress_pack(connection->compress.algorithm,
+                connection->compress.packed + 7, connection->compress.packed_size - 7, data, length);
+        }
+
+        if (packed == 0 || packed >= length)
+        {
+            /*
+             * Tiny or incompressible, send as is
+             */
+            memcpy(connection->compress.packed + 7, data, length);
+            packed = length;
+            unpacked = 0;
+        }
+
+        header = (unsigned char*)connection->compress.packed;
+        header[0] = (unsigned char)packed;
+        header[1] = (unsigned char)(packed >> 8);
+        header[2] = (unsigned char)(packed >> 16);
+        header[3] = connection->compress.sequence++;
+        header[4] = (unsigned char)unpacked;
+        header[5] = (unsigned char)(unpacked >> 8);
+        header[6] = (unsigned char)(unpacked >> 16);
+
+        if (7 + packed != api_stream_write(&connection->tcp.stream, connection->compress.packed, 7 + packed))
+            return 0;
+
+        data += length;
+        size -= length;
+    }
+
+    return 1;
+}
+
+void db_mysql_compress_free(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+
+    if (connection->compress.packed_size > 0)
+        api_free(pool, connection->compress.packed_size, connection->compress.packed);
+
+    if (connection->compress.data_size > 0)
+        api_free(pool, connection->compress.data_size, connection->compress.data);
+
+    memset(&connection->compress, 0, sizeof(connection->compress));
+}
@@ -19,6 +19,8 @@
  * IN THE SOFTWARE.
  */
 
+#include <stdio.h> /* for sprintf */
+
 #include "../3rdparty/shaman/sha1.h"
 #include "db_mysql.h"
 
@@ -38,6 +40,7 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
     int length_schema;
     int length;
     int replied;
+    int compress;
     char* reply;
     char auth[20];
     char buf1[2 * SHA1_HASH_SIZE];
@@ -84,6 +87,7 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
     if (DB_OK != error)
     {
         api_stream_close(&con->tcp.stream);
+        db_mysql_buffers_free(con);
         api_free(pool, sizeof(*con), con);
         return DB_CONNECT_FAILED;
     }
@@ -99,6 +103,7 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
         con->session->server.low_version = 1;
         db_mysql_free(con, &packet);
         api_stream_close(&con->tcp.stream);
+        db_mysql_buffers_free(con);
         api_free(pool, sizeof(*con), con);
         return DB_NOT_SUPPORTED;
     }
@@ -107,6 +112,7 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
      * Save first 8 byte of 20 byte length random data
      */
     offset = 1 + strlen(handshake + 1) + 1;
+    con->thread_id = *(uint32_t*)(handshake + offset);
     memcpy(auth, handshake + offset + 4, 8);
     offset += 4 + 9;
 
@@ -117,10 +123,17 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
     {
         con->session->server.charset = *(handshake + offset);
         offset += (1 + 2);
-        con->session->server.capabilities |= *(unsigned short*)(handshake + offset);
+        con->session->server.capabilities |= *(unsigned short*)(handshake + offset) << 16;
         offset += 2;
 
         offset += 1;
+
+        /*
+         * MariaDB puts extended capabilities to last 4 of reserved bytes
+         */
+        if (!(con->session->server.capabilities & CLIENT_LONG_PASSWORD))
+            con->session->server.mariadb_capabilities = *(int*)(handshake + offset + 6);
+
         offset += 10;
 
         /*
@@ -131,6 +144,8 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
 
     db_mysql_free(con, &packet);
 
+    compress = db_mysql_compress_negotiate(session);
+
     /*
      * Send credentials
      */
@@ -146,7 +161,8 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
             + 1 // length sha1
             + SHA1_HASH_SIZE
             + length_schema
-            + sizeof("mysql_native_password");
+            + sizeof("mysql_native_password")
+            + (compress == DB_MYSQL_COMPRESS_ZSTD ? 1 : 0); // zstd compression level
 
     reply = (char*)api_calloc(pool, length + 4);
 
@@ -156,9 +172,23 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
     *((int*)reply + 1) = 
         (/*CLIENT_FOUND_ROWS |*/ CLIENT_LONG_FLAG | CLIENT_CONNECT_WITH_DB |
         CLIENT_IGNORE_SPACE | CLIENT_PROTOCOL_41 | CLIENT_IGNORE_SIGPIPE | CLIENT_TRANSACTIONS |
-        CLIENT_SECURE_CONNECTION | CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS | CLIENT_PS_MULTI_RESULTS);
+        CLIENT_SECURE_CONNECTION | CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS | CLIENT_PS_MULTI_RESULTS |
+        CLIENT_LOCAL_FILES); // files are sent only when asked by db_mysql_connection_load
+
+    if (compress == DB_MYSQL_COMPRESS_ZLIB)
+        *((int*)reply + 1) |= CLIENT_COMPRESS;
+
+    if (compress == DB_MYSQL_COMPRESS_ZSTD)
+    {
+        /*
+         * Level byte follows plugin name, so server has to parse it
+         */
+        *((int*)reply + 1) |= CLIENT_ZSTD_COMPRESSION_ALGORITHM | CLIENT_PLUGIN_AUTH;
+        reply[4 + length - 1] = DB_MYSQL_ZSTD_LEVEL;
+    }
 
     *(reply + 4 + 4 + 4) = 33; // utf8
+    *(int*)(reply + 4 + 4 + 4 + 1 + 19) = con->session->server.mariadb_capabilities & MARIADB_CLIENT_STMT_BULK_OPERATIONS;
     strcpy(reply + 4 + 4 + 4 + 1 + 23, con->session->username);
     *(reply + 4 + 4 + 4 + 1 + 23 + length_username) = SHA1_HASH_SIZE;
 
@@ -203,6 +233,7 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
     if (replied != length + 4)
     {
         api_stream_close(&con->tcp.stream);
+        db_mysql_buffers_free(con);
         api_free(pool, sizeof(*con), con);
         return DB_UNAVAILABLE;
     }
@@ -225,12 +256,18 @@ int db_mysql_connection_create(db_mysql_session_t* session, db_mysql_connection_
 
         db_mysql_status_free(pool, &status);
         api_stream_close(&con->tcp.stream);
+        db_mysql_buffers_free(con);
         api_free(pool, sizeof(*con), con);
         return DB_FAILED;
     }
 
     db_mysql_status_free(pool, &status);
 
+    /*
+     * Everything after auth goes compressed
+     */
+    con->compress.algorithm = compress;
+
     *connection = con;
     return DB_OK;
 }
@@ -252,41 +289,30 @@ int db_mysql_connection_error(db_mysql_connection_t* connection, db_error_t* err
 
 int db_mysql_connection_query(db_mysql_connection_t* connection, const char* sql, db_mysql_result_t** result)
 {
-    int sql_length = strlen(sql);
-    char command[5];
+    char command = COM_QUERY;
+    db_mysql_iovec_t iov[2];
     int code;
 
     if (result)
         *result = 0;
 
     /*
-     * Eat pending resultsets
+     * Eat pending resultsets and pipelined responses
      */
-    db_mysql_eat_result(connection);
+    db_mysql_sync(connection);
 
     /*
-     * Send COM_QUERY command
+     * Send COM_QUERY command and sql by single write
      */
 
-    *(int*)command = 1 /* COM_QUERY */
-                   + sql_length;
-
-    command[3] = 0; // reset sequence
-    command[4] = COM_QUERY;
+    iov[0].data = &command;
+    iov[0].size = 1;
+    iov[1].data = sql;
+    iov[1].size = strlen(sql);
 
-    /* header and code */
-    if (5 != api_stream_write(&connection->tcp.stream, command, 5))
-    {
-        connection->undefined = 1;
-        return DB_UNAVAILABLE;
-    }
-
-    /* sql */
-    if (sql_length != api_stream_write(&connection->tcp.stream, sql, sql_length))
-    {
-        connection->undefined = 1;
-        return DB_UNAVAILABLE;
-    }
+    code = db_mysql_writev(connection, 0 /* reset sequence */, iov, 2);
+    if (DB_OK != code)
+        return code;
 
     /*
      * Read result
@@ -308,6 +334,55 @@ int db_mysql_connection_query(db_mysql_connection_t* connection, const char* sql
     return code;
 }
 
+int db_mysql_connection_send_query(db_mysql_connection_t* connection, const char* sql)
+{
+    char command = COM_QUERY;
+    db_mysql_iovec_t iov[2];
+    int code;
+
+    /*
+     * Gather command with other pipelined ones, response is read
+     * by db_mysql_connection_read_result
+     */
+
+    iov[0].data = &command;
+    iov[0].size = 1;
+    iov[1].data = sql;
+    iov[1].size = strlen(sql);
+
+    connection->output.defer = 1;
+    code = db_mysql_writev(connection, 0 /* reset sequence */, iov, 2);
+    connection->output.defer = 0;
+
+    if (DB_OK == code)
+        db_mysql_pipeline_push(connection, 0);
+
+    return code;
+}
+
+int db_mysql_connection_read_result(db_mysql_connection_t* connection, db_mysql_result_t** result)
+{
+    int statement_id;
+    int code;
+
+    *result = 0;
+
+    if (!db_mysql_pipeline_pop(connection, &statement_id))
+    {
+        /*
+         * Responses of all sent commands are already read
+         */
+        db_mysql_eat_result(connection);
+        return DB_NO_DATA;
+    }
+
+    code = db_mysql_read_result(connection, statement_id);
+    if (DB_OK == code)
+        *result = connection->result;
+
+    return code;
+}
+
 int db_mysql_connection_affected(db_mysql_connection_t* connection, uint64_t* affected)
 {
     *affected = connection->affected;
@@ -320,6 +395,29 @@ int db_mysql_connection_insert_id(db_mysql_connection_t* connection, uint64_t* i
     return DB_OK;
 }
 
+int db_mysql_connection_load(db_mysql_connection_t* connection, const char* sql, const char* name, db_read_fn fn, void* arg)
+{
+    int code;
+
+    /*
+     * Source is used by db_mysql_read_result, when server asks for file
+     */
+    connection->infile.name = name;
+    connection->infile.fn = fn;
+    connection->infile.arg = arg;
+
+    /*
+     * Call through iface, in case when iface was hooked
+     */
+    code = connection->session->base.iface.connection.query((db_connection_t*)connection, sql, 0 /* skip results ? */);
+
+    connection->infile.name = 0;
+    connection->infile.fn = 0;
+    connection->infile.arg = 0;
+
+    return code;
+}
+
 int db_mysql_connection_begin(db_mysql_connection_t* connection)
 {
     /*
@@ -358,9 +456,9 @@ int db_mysql_connection_close(db_mysql_connection_t* connection)
     else
     {
         /*
-         * Eat pending resultsets
+         * Eat pending resultsets and pipelined responses
          */
-        db_mysql_eat_result(connection);
+        db_mysql_sync(connection);
 
         /*
          * Put back into pool
@@ -369,28 +467,49 @@ int db_mysql_connection_close(db_mysql_connection_t* connection)
     }
 }
 
+int db_mysql_connection_kill_query(db_mysql_connection_t* connection)
+{
+    db_iface_t* iface = &connection->session->base.iface;
+    db_connection_t* side;
+    char sql[32];
+    int code;
+
+    /*
+     * Connection is busy by query, so command goes through another one
+     */
+    code = iface->connection.open((db_session_t*)connection->session, &side);
+    if (DB_OK != code)
+        return code;
+
+    sprintf(sql, "KILL QUERY %u", connection->thread_id);
+
+    code = iface->connection.query(side, sql, 0 /* skip results */);
+    iface->connection.close(side);
+
+    return code;
+}
+
 /*
  * Called from db_pool if cache is full
  */
 int db_mysql_connection_destroy(db_mysql_connection_t* connection)
 {
     api_pool_t* pool = api_pool_default(connection->session->base.loop);
-    char command[5];
+    char command = COM_QUIT;
+    db_mysql_iovec_t iov;
+    int statement_id;
 
     db_error_cleanup(pool, &connection->error);
 
     if (!connection->undefined)
     {
-        memset(command, 0, 5);
-        command[0] = 1; // packet size
-        command[4] = COM_QUIT;
+        iov.data = &command;
+        iov.size = 1;
 
-        if (5 == api_stream_write(&connection->tcp.stream, command, 5))
-        {
-            /*
-             * Is there a reason for waiting status packet here ?
-             */
-        }
+        /*
+         * Is there a reason for waiting status packet here ?
+         */
+        db_mysql_writev(connection, 0, &iov, 1);
     }
 
     /*
@@ -399,7 +518,12 @@ int db_mysql_connection_destroy(db_mysql_connection_t* connection)
     if (connection->result)
         db_mysql_result_close(connection->result);
 
+    while (db_mysql_pipeline_pop(connection, &statement_id))
+    {
+    }
+
     api_stream_close(&connection->tcp.stream);
+    db_mysql_buffers_free(connection);
     api_free(pool, sizeof(*connection), connection);
 
     return DB_OK;
@@ -0,0 +1,271 @@
+/* Copyright (c) 2014, Artak Khnkoyan <artak.khnkoyan@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Parsing of numbers sent as text by text protocol rows
+ */
+
+#include <stdlib.h> /* for strtod, strtof */
+
+#include "db_mysql.h"
+
+#define DB_MYSQL_DIGITS8_LOW  0x3030303030303030ULL
+#define DB_MYSQL_DIGITS8_HIGH 0xF0F0F0F0F0F0F0F0ULL
+
+static const double db_mysql_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float db_mysql_pow10f[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/*
+ * Returns non zero when all 8 bytes are ascii digits
+ */
+static int db_mysql_is_digits8(uint64_t value)
+{
+    return (value & DB_MYSQL_DIGITS8_HIGH) == DB_MYSQL_DIGITS8_LOW &&
+           ((value + 0x0606060606060606ULL) & DB_MYSQL_DIGITS8_HIGH) == DB_MYSQL_DIGITS8_LOW;
+}
+
+/*
+ * Converts 8 ascii digits loaded as little endian word, first digit
+ * in lowest byte, by combining pairs, quads and octets of digits
+ */
+static uint64_t db_mysql_parse_digits8(uint64_t value)
+{
+    value = ((value & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    value = ((value & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    value = ((value & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+
+    return value;
+}
+
+/*
+ * Accumulates leading digits into value, returns count of digits consumed.
+ * Digits above 19 set overflow when value does not fit 64 bits
+ */
+static int db_mysql_parse_digits(const char* buffer, int length, uint64_t* value, int* overflow)
+{
+    uint64_t word;
+    uint64_t result = *value;
+    unsigned int digit;
+    int i = 0;
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    /*
+     * 8 digits at once while value * 10^8 surely fits 64 bits
+     */
+    while (i + 8 <= length && result < 10000000000ULL)
+    {
+        memcpy(&word, buffer + i, 8);
+        if (!db_mysql_is_digits8(word))
+            break;
+
+        result = result * 100000000ULL + db_mysql_parse_digits8(word);
+        i += 8;
+    }
+#endif
+
+    while (i < length)
+    {
+        digit = (unsigned char)buffer[i] - '0';
+        if (digit > 9)
+            break;
+
+        if (result > (UINT64_MAX - digit) / 10)
+        {
+            *overflow = 1;
+            result = UINT64_MAX;
+        }
+        else
+        {
+            result = result * 10 + digit;
+        }
+
+        ++i;
+    }
+
+    *value = result;
+
+    return i;
+}
+
+int64_t db_mysql_parse_integer(const char* buffer, int length)
+{
+    uint64_t value = 0;
+    int is_negative = 0;
+    int overflow = 0;
+    int i = 0;
+
+    if (length > 0 && (buffer[0] == '-' || buffer[0] == '+'))
+    {
+        is_negative = buffer[0] == '-';
+        ++i;
+    }
+
+    db_mysql_parse_digits(buffer + i, length - i, &value, &overflow);
+
+    if (is_negative)
+    {
+        /*
+         * Saturate to INT64_MIN
+         */
+        if (overflow || value > (uint64_t)INT64_MAX + 1)
+            return INT64_MIN;
+
+        return (int64_t)(0 - value);
+    }
+
+    /*
+     * Values above INT64_MAX are BIGINT UNSIGNED, kept by bit pattern
+     */
+    return (int64_t)value;
+}
+
+/*
+ * Splits decimal number into up to 19 significant digits and power of ten.
+ * Returns 0 when number is not exact this way, or has unexpected chars
+ */
+static int db_mysql_decompose(const char* buffer, int length, int* is_negative, uint64_t* mantissa, int* exponent)
+{
+    int overflow = 0;
+    int exp_negative = 0;
+    uint64_t exp_value = 0;
+    int digits;
+    int i = 0;
+
+    *is_negative = 0;
+    *mantissa = 0;
+    *exponent = 0;
+
+    if (i < length && (buffer[i] == '-' || buffer[i] == '+'))
+    {
+        *is_negative = buffer[i] == '-';
+        ++i;
+    }
+
+    digits = db_mysql_parse_digits(buffer + i, length - i, mantissa, &overflow);
+    i += digits;
+
+    if (i < length && buffer[i] == '.')
+    {
+        ++i;
+        digits = db_mysql_parse_digits(buffer + i, length - i, mantissa, &overflow);
+        i += digits;
+        *exponent -= digits;
+    }
+
+    if (i < length && (buffer[i] == 'e' || buffer[i] == 'E'))
+    {
+        ++i;
+
+        if (i < length && (buffer[i] == '-' || buffer[i] == '+'))
+        {
+            exp_negative = buffer[i] == '-';
+            ++i;
+        }
+
+        digits = db_mysql_parse_digits(buffer + i, length - i, &exp_value, &overflow);
+        if (digits == 0 || exp_value > 1000)
+            return 0;
+
+        i += digits;
+        *exponent += exp_negative ? -(int)exp_value : (int)exp_value;
+    }
+
+    /*
+     * Mantissa above 10^19 lost digits
+     */
+    return !overflow && i == length;
+}
+
+/*
+ * Correctly rounded fallback for numbers outside of fast path
+ */
+static double db_mysql_parse_slow(const char* buffer, int length, int is_float)
+{
+    char temp[100];
+
+    if (length > (int)sizeof(temp) - 1)
+        length = sizeof(temp) - 1;
+
+    memcpy(temp, buffer, length);
+    temp[length] = 0;
+
+    return is_float ? strtof(temp, 0) : strtod(temp, 0);
+}
+
+double db_mysql_parse_double(const char* buffer, int length)
+{
+    uint64_t mantissa;
+    int is_negative;
+    int exponent;
+    double value;
+
+    /*
+     * Clinger fast path, mantissa and power of ten are exact doubles,
+     * so single multiplication or division rounds correctly
+     */
+    if (db_mysql_decompose(buffer, length, &is_negative, &mantissa, &exponent) &&
+        mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        value = (double)mantissa;
+
+        if (exponent < 0)
+            value /= db_mysql_pow10[-exponent];
+        else
+            value *= db_mysql_pow10[exponent];
+
+        return is_negative ? -value : value;
+    }
+
+    return db_mysql_parse_slow(buffer, length, 0);
+}
+
+float db_mysql_parse_float(const char* buffer, int length)
+{
+    uint64_t mantissa;
+    int is_negative;
+    int exponent;
+    float value;
+
+    /*
+     * Same fast path in single precision, rounding through double
+     * could round twice
+     */
+    if (db_mysql_decompose(buffer, length, &is_negative, &mantissa, &exponent) &&
+        mantissa <= (1ULL << 24) && exponent >= -10 && exponent <= 10)
+    {
+        value = (float)mantissa;
+
+        if (exponent < 0)
+            value /= db_mysql_pow10f[-exponent];
+        else
+            value *= db_mysql_pow10f[exponent];
+
+        return is_negative ? -value : value;
+    }
+
+    return (float)db_mysql_parse_slow(buffer, length, 1);
+}
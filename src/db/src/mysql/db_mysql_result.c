@@ -19,8 +19,6 @@
  * IN THE SOFTWARE.
  */
 
-#include <stdio.h> /* for sscanf */
-
 #include "../api_list.h"
 #include "db_mysql.h"
 
@@ -31,190 +29,384 @@ typedef struct db_mysql_row_node_t {
 } db_mysql_row_node_t;
 
 /*
- * Reads value encoded as binary
+ * State of row parsed by fragments
+ */
+typedef struct db_mysql_row_stream_t {
+    db_mysql_result_t* result;
+    int column; // column which value is passed to fn
+    db_write_fn fn;
+    void* arg;
+    int is_null;
+    int index; // column being parsed
+    int in_value; // value length is known, skipping or passing its bytes
+    uint64_t remaining; // bytes left of current value
+    char prefix[9]; // length prefix collected so far
+    int prefix_size;
+    int header_size; // binary protocol, packet code and null bitmap
+    int header_done;
+    char bitmap[DB_MYSQL_MAX_BITMAP];
+} db_mysql_row_stream_t;
+
+/*
+ * Reads lenencstr allocating it from arena
  */
-uint64_t db_mysql_read_value(api_pool_t* pool, char* buffer, db_column_t* column, db_value_t* value)
+static uint64_t db_mysql_read_lenencstr_arena(db_arena_t* arena, char* buffer, char** str, uint64_t* length)
 {
-    unsigned char length;
+    uint64_t count;
+    uint64_t len;
 
-    switch (column->type)
-    {
-    case DB_TYPE_BOOL:
-    case DB_TYPE_BYTE:
-        value->value_byte = *buffer;
-        return 1;
-    case DB_TYPE_SHORT:
-        value->value_short = *(short*)buffer;
-        return 2;
-    case DB_TYPE_INT:
-        value->value_int = *(int*)buffer;
-        return 4;
-    case DB_TYPE_INT64:
-        value->value_int64 = *(int64_t*)buffer;
-        return 8;
-    case DB_TYPE_FLOAT:
-        value->value_float = *(float*)buffer;
-        return sizeof(float);
-    case DB_TYPE_DOUBLE:
-        value->value_double = *(double*)buffer;
-        return sizeof(double);
-    case DB_TYPE_TIME:
-        length = *buffer;
-        ++buffer;
+    len = db_mysql_read_lenencint(buffer, &count);
+    *str = (char*)db_arena_alloc(arena, (size_t)len + 1);
+    memcpy(*str, buffer + count, (size_t)len);
+    (*str)[len] = 0;
 
-        if (length >= 8)
-        {
-            value->value_time.is_negative = *buffer; buffer += 1;
-            value->value_time.days = *(int*)buffer; buffer += 4;
-            value->value_time.hours = *buffer; buffer += 1;
-            value->value_time.minutes = *buffer; buffer += 1;
-            value->value_time.seconds = *buffer; buffer += 1;
-        }
+    if (length)
+        *length = len;
 
-        if (length >= 12)
-        {
-            value->value_time.microseconds = *(int*)buffer; buffer += 4;
-        }
+    return count + len;
+}
 
-        return 1 + length;
-    case DB_TYPE_DATE:
-    case DB_TYPE_DATETIME:
-    case DB_TYPE_TIMESTAMP:
-        length = *buffer;
-        ++buffer;
+/*
+ * Binary protocol decoders, buffer points to value
+ */
 
-        if (length >= 4)
-        {
-            value->value_date.year = *(short*)buffer; buffer += 2;
-            value->value_date.month = *buffer; buffer += 1;
-            value->value_date.day = *buffer; buffer += 1;
-        }
+static uint64_t db_mysql_decode_byte(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_byte = *buffer;
+    return 1;
+}
 
-        if (length >= 7)
-        {
-            value->value_date.hour = *buffer; buffer += 1;
-            value->value_date.minute = *buffer; buffer += 1;
-            value->value_date.second = *buffer; buffer += 1;
-        }
+static uint64_t db_mysql_decode_short(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_short = *(short*)buffer;
+    return 2;
+}
 
-        if (length == 11)
-        {
-            value->value_date.microsecond = *(int*)buffer; buffer += 4;
-        }
+static uint64_t db_mysql_decode_int(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_int = *(int*)buffer;
+    return 4;
+}
+
+static uint64_t db_mysql_decode_int64(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_int64 = *(int64_t*)buffer;
+    return 8;
+}
+
+static uint64_t db_mysql_decode_float(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_float = *(float*)buffer;
+    return sizeof(float);
+}
 
-        return 1 + length;
+static uint64_t db_mysql_decode_double(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    value->value_double = *(double*)buffer;
+    return sizeof(double);
+}
+
+static uint64_t db_mysql_decode_time(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    unsigned char length = *buffer;
+
+    ++buffer;
+
+    /*
+     * Fields not covered by length are zero, rows may be reused
+     */
+    memset(&value->value_time, 0, sizeof(value->value_time));
 
-    default: // DB_TYPE_STRING or DB_TYPE_BINARY
-        return db_mysql_read_lenencstr(pool, buffer, &value->value_string, &value->size);
+    if (length >= 8)
+    {
+        value->value_time.is_negative = *buffer; buffer += 1;
+        value->value_time.days = *(int*)buffer; buffer += 4;
+        value->value_time.hours = *buffer; buffer += 1;
+        value->value_time.minutes = *buffer; buffer += 1;
+        value->value_time.seconds = *buffer; buffer += 1;
+    }
+
+    if (length >= 12)
+    {
+        value->value_time.microseconds = *(int*)buffer; buffer += 4;
     }
+
+    return 1 + length;
 }
 
-uint64_t db_mysql_parse_numeric(char* buffer, int length)
+static uint64_t db_mysql_decode_date(db_arena_t* arena, char* buffer, db_value_t* value)
 {
-    uint64_t value = 0;
-    int i;
+    unsigned char length = *buffer;
+
+    ++buffer;
+
+    /*
+     * Fields not covered by length are zero, rows may be reused
+     */
+    memset(&value->value_date, 0, sizeof(value->value_date));
+
+    if (length >= 4)
+    {
+        value->value_date.year = *(short*)buffer; buffer += 2;
+        value->value_date.month = *buffer; buffer += 1;
+        value->value_date.day = *buffer; buffer += 1;
+    }
+
+    if (length >= 7)
+    {
+        value->value_date.hour = *buffer; buffer += 1;
+        value->value_date.minute = *buffer; buffer += 1;
+        value->value_date.second = *buffer; buffer += 1;
+    }
 
-    for (i = 0; i < length; ++i)
+    if (length == 11)
     {
-        value = 10 * value + (buffer[i] - '0');
+        value->value_date.microsecond = *(int*)buffer; buffer += 4;
     }
 
-    return value;
+    return 1 + length;
 }
 
 /*
- * Reads value encoded as raw text
+ * Strings and binaries are the same in both protocols
  */
-uint64_t db_mysql_parse_value(api_pool_t* pool, char* buffer, db_column_t* column, db_value_t* value)
+static uint64_t db_mysql_decode_string(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    return db_mysql_read_lenencstr_arena(arena, buffer, &value->value_string, &value->size);
+}
+
+/*
+ * Strings referencing packet in place, DB_MYSQL_ZERO_COPY
+ */
+static uint64_t db_mysql_decode_string_view(db_arena_t* arena, char* buffer, db_value_t* value)
 {
     uint64_t count;
-    uint64_t length;
-    char temp[100];  // large enough to store float, double values
-    char* pos;
 
-    length = db_mysql_read_lenencint(buffer, &count);
+    value->size = db_mysql_read_lenencint(buffer, &count);
+    value->value_string = buffer + count;
+
+    return count + value->size;
+}
+
+/*
+ * Text protocol decoders, buffer points to length prefix of value
+ */
+
+static uint64_t db_mysql_parse_integer_value(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    uint64_t count;
+    uint64_t length = db_mysql_read_lenencint(buffer, &count);
+
+    value->value_int64 = db_mysql_parse_integer(buffer + count, (int)length);
+    return count + length;
+}
+
+static uint64_t db_mysql_parse_float_value(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    uint64_t count;
+    uint64_t length = db_mysql_read_lenencint(buffer, &count);
+
+    value->value_float = db_mysql_parse_float(buffer + count, (int)length);
+    return count + length;
+}
+
+static uint64_t db_mysql_parse_double_value(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    uint64_t count;
+    uint64_t length = db_mysql_read_lenencint(buffer, &count);
+
+    value->value_double = db_mysql_parse_double(buffer + count, (int)length);
+    return count + length;
+}
+
+static uint64_t db_mysql_parse_time_value(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    uint64_t count;
+    uint64_t length = db_mysql_read_lenencint(buffer, &count);
+    char* pos = buffer + count;
+
+    memset(&value->value_time, 0, sizeof(value->value_time));
+
+    value->value_time.hours = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_time.minutes = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_time.seconds = (pos[0] - '0') * 10 + (pos[1] - '0');
+
+    return count + length;
+}
+
+static uint64_t db_mysql_parse_date_value(db_arena_t* arena, char* buffer, db_value_t* value)
+{
+    uint64_t count;
+    uint64_t length = db_mysql_read_lenencint(buffer, &count);
+    char* pos = buffer + count;
+
+    memset(&value->value_date, 0, sizeof(value->value_date));
+
+    value->value_date.year = (pos[0] - '0') * 1000 + (pos[1] - '0') * 100 + (pos[2] - '0') * 10 + (pos[3] - '0'); pos += 5;
+    value->value_date.month = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_date.day = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_date.hour = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_date.minute = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
+    value->value_date.second = (pos[0] - '0') * 10 + (pos[1] - '0');
+
+    return count + length;
+}
 
-    switch (column->type)
+/*
+ * Returns decoder of column type for binary or text protocol
+ */
+static db_mysql_decode_fn db_mysql_decoder(int type, int is_binary, int zero_copy)
+{
+    switch (type)
     {
     case DB_TYPE_BOOL:
     case DB_TYPE_BYTE:
+        return is_binary ? db_mysql_decode_byte : db_mysql_parse_integer_value;
     case DB_TYPE_SHORT:
+        return is_binary ? db_mysql_decode_short : db_mysql_parse_integer_value;
     case DB_TYPE_INT:
+        return is_binary ? db_mysql_decode_int : db_mysql_parse_integer_value;
     case DB_TYPE_INT64:
-        value->value_int64 = db_mysql_parse_numeric(buffer + count, length);
-        break;
+        return is_binary ? db_mysql_decode_int64 : db_mysql_parse_integer_value;
     case DB_TYPE_FLOAT:
-        memcpy(temp, buffer + count, length);
-        temp[length] = ' ';
-        sscanf(temp, "%f", &value->value_float);
-        break;
+        return is_binary ? db_mysql_decode_float : db_mysql_parse_float_value;
     case DB_TYPE_DOUBLE:
-        memcpy(temp, buffer + count, length);
-        temp[length] = ' ';
-        sscanf(temp, "%lf", &value->value_double);
-        break;
+        return is_binary ? db_mysql_decode_double : db_mysql_parse_double_value;
     case DB_TYPE_TIME:
-        pos = buffer + count;
-        value->value_time.hours = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_time.minutes = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_time.seconds = (pos[0] - '0') * 10 + (pos[1] - '0');
-        break;
+        return is_binary ? db_mysql_decode_time : db_mysql_parse_time_value;
     case DB_TYPE_DATE:
     case DB_TYPE_DATETIME:
     case DB_TYPE_TIMESTAMP:
-        pos = buffer + count;
-        value->value_date.year = (pos[0] - '0') * 1000 + (pos[1] - '0') * 100 + (pos[2] - '0') * 10 + (pos[3] - '0'); pos += 5;
-        value->value_date.month = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_date.day = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_date.hour = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_date.minute = (pos[0] - '0') * 10 + (pos[1] - '0'); pos += 3;
-        value->value_date.second = (pos[0] - '0') * 10 + (pos[1] - '0');
-        break;
-    default: // DB_TYPE_STRING or DB_TYPE_BINARY
-        db_mysql_read_lenencstr(pool, buffer, &value->value_string, &value->size);
-        break;
+        return is_binary ? db_mysql_decode_date : db_mysql_parse_date_value;
     }
 
-    return length + count;
+    /*
+     * DB_TYPE_STRING or DB_TYPE_BINARY
+     */
+    return zero_copy ? db_mysql_decode_string_view : db_mysql_decode_string;
 }
 
-db_value_t* db_mysql_result_read_row(db_mysql_result_t* result, db_mysql_packet_t* packet)
+/*
+ * Returns bytes count of binary encoded fixed size values, 0 for length prefixed ones
+ */
+static int db_mysql_fixed_size(int type)
 {
-    api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
-    db_value_t* row = (db_value_t*)api_calloc(pool, result->num_columns * sizeof(db_value_t));
-    char* pos;
+    switch (type)
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        return 1;
+    case DB_TYPE_SHORT:
+        return 2;
+    case DB_TYPE_INT:
+    case DB_TYPE_FLOAT:
+        return 4;
+    case DB_TYPE_INT64:
+    case DB_TYPE_DOUBLE:
+        return 8;
+    }
+
+    /*
+     * Strings, binaries and temporal values are length prefixed
+     */
+    return 0;
+}
+
+/*
+ * Builds decode plan of current resultset once columns are known,
+ * rows of resultset are decoded without per value type dispatch
+ */
+static void db_mysql_result_build_plan(db_mysql_result_t* result)
+{
+    db_mysql_column_plan_t* plan;
+    int is_binary = result->statement_id > 0;
+    int offset = 0;
+    int size;
     int i;
 
-    if (result->statement_id > 0)
+    plan = (db_mysql_column_plan_t*)db_arena_alloc(&result->meta, result->num_columns * sizeof(*plan));
+
+    /*
+     * Binary rows: [0x00][null bitmap][values], first two bitmap bits are reserved
+     */
+    result->bitmap_size = is_binary ? (result->num_columns + 7 + 2) / 8 : 0;
+    result->all_fixed = is_binary;
+    result->zero_copy = DB_MYSQL_ZERO_COPY == (result->connection->session->flags & DB_MYSQL_ZERO_COPY);
+
+    for (i = 0; i < result->num_columns; ++i)
     {
-        /*
-         * Read binary protocol rows
-         */
+        plan[i].decode = db_mysql_decoder(result->columns[i].type, is_binary, result->zero_copy);
+        plan[i].null_byte = (i + 2) / 8;
+        plan[i].null_shift = (i + 2) % 8;
 
         /*
-         * Skip '\0' (OK code)
+         * Offsets are valid for rows without nulls only
          */
-        pos = packet->data + 1;
+        size = is_binary ? db_mysql_fixed_size(result->columns[i].type) : 0;
+        if (size == 0)
+            result->all_fixed = 0;
+
+        plan[i].offset = offset;
+        offset += size;
+    }
+
+    result->plan = plan;
+}
+
+/*
+ * Decodes row packet into row values by plan, strings are allocated from rows arena
+ */
+static void db_mysql_result_parse_row(db_mysql_result_t* result, db_mysql_column_plan_t* plan, db_mysql_packet_t* packet, db_value_t* row)
+{
+    unsigned char* bitmap;
+    unsigned char nulls = 0;
+    char* pos;
+    int i;
 
+    if (result->statement_id > 0)
+    {
         /*
-         * null bitmap
+         * Read binary protocol rows, skip '\0' (OK code)
          */
-        for (i = 0; i < result->num_columns; ++i)
+        bitmap = (unsigned char*)packet->data + 1;
+        pos = packet->data + 1 + result->bitmap_size;
+
+        for (i = 0; i < result->bitmap_size; ++i)
+            nulls |= bitmap[i];
+
+        if (nulls == 0)
         {
-            row[i].is_null = 0 != (pos[i / 8] & (i % 8));
+            for (i = 0; i < result->num_columns; ++i)
+                row[i].is_null = 0;
+
+            if (result->all_fixed)
+            {
+                /*
+                 * Values are at known offsets, decode without dependency
+                 * on previous values
+                 */
+                for (i = 0; i < result->num_columns; ++i)
+                    plan[i].decode(&result->arena, pos + plan[i].offset, row + i);
+
+                return;
+            }
+
+            for (i = 0; i < result->num_columns; ++i)
+                pos += plan[i].decode(&result->arena, pos, row + i);
+
+            return;
         }
 
         /*
-         * values. null bitmap length: (column-count + 7 + 2) / 8
+         * Null values are not present in binary rows
          */
-        pos += (result->num_columns + 7 + 2) / 8;
+        for (i = 0; i < result->num_columns; ++i)
+            row[i].is_null = (bitmap[plan[i].null_byte] >> plan[i].null_shift) & 1;
 
         for (i = 0; i < result->num_columns; ++i)
         {
             if (!row[i].is_null)
-            {
-                pos += db_mysql_read_value(pool, pos, result->columns + i, row + i);
-            }
+                pos += plan[i].decode(&result->arena, pos, row + i);
         }
     }
     else
@@ -236,120 +428,396 @@ db_value_t* db_mysql_result_read_row(db_mysql_result_t* result, db_mysql_packet_
             else
             {
                 row[i].is_null = 0;
-                pos += db_mysql_parse_value(pool, pos, result->columns + i, row + i);
+                pos += plan[i].decode(&result->arena, pos, row + i);
             }
         }
     }
+}
+
+db_value_t* db_mysql_result_read_row(db_mysql_result_t* result, db_mysql_packet_t* packet)
+{
+    db_value_t* row = (db_value_t*)db_arena_alloc(&result->arena, result->num_columns * sizeof(db_value_t));
+
+    memset(row, 0, result->num_columns * sizeof(db_value_t));
+    db_mysql_result_parse_row(result, result->plan, packet, row);
 
     return row;
 }
 
 void db_mysql_result_free_columns(db_mysql_result_t* result)
 {
-    api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
-    int i;
+    /*
+     * Columns, names, types and reused row are in columns arena
+     */
+    db_arena_reset(&result->meta);
+
+    result->columns = 0;
+    result->mysql_types = 0;
+    result->plan = 0;
+    result->row = 0;
+    result->bound = 0;
+    result->bound_plan = 0;
+    result->num_columns = 0;
+}
 
-    if (result->num_columns > 0 && result->columns != 0)
-    {
-        for (i = 0; i < result->num_columns; ++i)
-            if (result->columns[i].name)
-            {
-                api_free(pool, strlen(result->columns[i].name) + 1, result->columns[i].name);
-                result->columns[i].name = 0;
-            }
+void db_mysql_result_free_rows(db_mysql_result_t* result)
+{
+    /*
+     * Rows, values and row list are in rows arena, chunks are kept
+     * for the next batch
+     */
+    db_arena_reset(&result->arena);
+    db_arena_reset(&result->spare);
+
+    /*
+     * Packets referenced by zero copy values are not needed anymore
+     */
+    db_mysql_release(result->connection);
 
-        api_free(pool, result->num_columns * sizeof(db_column_t), result->columns);
-        api_free(pool, result->num_columns * sizeof(int), result->mysql_types);
+    result->rows = 0;
+    result->num_rows = 0;
 
-        result->columns = 0;
-        result->num_columns = 0;
-    }
+    result->ahead.code = DB_OK;
+    result->ahead.num_rows = 0;
+    result->ahead.list.head = 0;
+    result->ahead.list.tail = 0;
 }
 
-void db_mysql_result_free_rows(db_mysql_result_t* result)
+static void db_mysql_result_destroy(db_mysql_result_t* result)
 {
     api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
-    int i, j;
-
-    if (result->num_rows > 0)
-    {
-        for (i = 0; i < result->num_rows; ++i)
-        {
-            for (j = 0; j < result->num_columns; ++j)
-            {
-                if (!result->rows[i][j].is_null && (result->columns[i].type == DB_TYPE_STRING || result->columns[i].type == DB_TYPE_BINARY))
-                {
-                    api_free(pool, result->rows[i][j].size + 1, result->rows[i][j].value_string);
-                }
-            }
-
-            api_free(pool, result->num_columns * sizeof(db_value_t), result->rows[i]);
-        }
 
-        api_free(pool, result->num_rows * sizeof(db_value_t*), result->rows);
+    db_arena_free(&result->meta);
+    db_arena_free(&result->arena);
+    db_arena_free(&result->spare);
+    db_mysql_release(result->connection);
 
-        result->num_rows = 0;
-    }
+    api_free(pool, sizeof(*result), result);
 }
 
-int db_mysql_eat_result(db_mysql_connection_t* connection)
+/*
+ * Fetches batch of detached cursor through its origin connection, which
+ * is shared with other cursors and commands. Batch is read whole, so
+ * that connection is free again when this returns
+ */
+static int db_mysql_result_fetch_batch(db_mysql_result_t* result, db_mysql_iovec_t* iov)
 {
+    db_mysql_connection_t* detached = result->connection;
+    db_mysql_connection_t* connection = detached->store.origin;
     api_pool_t* pool = api_pool_default(connection->session->base.loop);
-    db_column_t* columns;
-    db_value_t** rows;
-    int num_columns;
-    int num_rows;
-    int count;
-    int code = DB_OK;
+    db_mysql_packet_t packet;
+    int done = 0;
 
-    if (connection->result == 0)
-        return DB_OK;
+    /*
+     * Eat pending resultsets and pipelined responses
+     */
+    db_mysql_sync(connection);
 
-    if (connection->undefined)
+    if (DB_OK != db_mysql_writev(connection, 0, iov, 1))
     {
-        db_mysql_result_free_columns(connection->result);
-        db_mysql_result_free_rows(connection->result);
-        api_free(pool, sizeof(*connection->result), connection->result);
-        connection->result = 0;
-
+        detached->undefined = 1;
         return DB_UNAVAILABLE;
     }
 
-    if (connection->result->num_columns > 0 && connection->result->columns == 0)
-    {
-        /*
-         * Fetched first resultsets column count
-         */
-    }
-    else if (!connection->result->rows_done)
-    {
-        /*
-         * Called in the middle of rows
-         */
-
-        while (DB_OK == code && !connection->result->rows_done)
-        {
-            code = db_mysql_result_fetch_rows(connection->result, &rows, &count);
-        }
-    }
-
     /*
-     * eat next resultsets
+     * Previous batch was replayed up to its EOF
      */
-    while (db_result_fetch_columns((db_result_t*)connection->result, &columns, &num_columns) == DB_OK)
+    detached->store.size = 0;
+    detached->store.pos = 0;
+
+    while (!done)
     {
-        num_rows = 0;
-        while (db_result_fetch_rows((db_result_t*)connection->result, &rows, &num_rows) == DB_OK && num_rows > 0)
+        if (DB_OK != db_mysql_read(connection, &packet))
         {
+            detached->undefined = 1;
+            return DB_UNAVAILABLE;
         }
-    }
-
-    db_mysql_result_free_columns(connection->result);
-    db_mysql_result_free_rows(connection->result);
-    api_free(pool, sizeof(*connection->result), connection->result);
-    connection->result = 0;
 
-    if (connection->undefined)
+        if (PACKET_IS_ERROR(packet))
+        {
+            db_mysql_parse_error(pool, &packet, &connection->error);
+            done = 1;
+        }
+        else if (PACKET_IS_EOF(packet))
+        {
+            done = 1;
+        }
+
+        db_mysql_store_packet(detached, &packet);
+        db_mysql_free(connection, &packet);
+    }
+
+    result->fetch.pending = 1;
+
+    return DB_OK;
+}
+
+/*
+ * Asks server side cursor for next rows, unless previous fetch is still
+ * being read. Count of rows is chosen to make up about fetch_size bytes
+ */
+static int db_mysql_result_fetch_more(db_mysql_result_t* result)
+{
+    uint64_t size = result->connection->session->fetch_size;
+    uint64_t average;
+    uint64_t count;
+    char cmd_fetch[9];
+    db_mysql_iovec_t iov;
+    int i;
+
+    if (!result->by_fetch || result->fetch.pending)
+        return DB_OK;
+
+    if (result->fetch.rows > 0)
+    {
+        average = result->fetch.bytes / result->fetch.rows;
+    }
+    else
+    {
+        /*
+         * No rows yet, guess by declared lengths, long ones are rarely full
+         */
+        average = 4 + 1 + (result->num_columns + 7 + 2) / 8;
+        for (i = 0; i < result->num_columns; ++i)
+            average += result->columns[i].length < 256 ? result->columns[i].length : 256;
+    }
+
+    count = size / (average > 0 ? average : 1);
+    if (count == 0)
+        count = 1;
+    else if (count > 0x7fffffff)
+        count = 0x7fffffff;
+
+    cmd_fetch[0] = COM_STMT_FETCH;
+    *(int*)(cmd_fetch + 1) = result->statement_id;
+    *(int*)(cmd_fetch + 5) = (int)count;
+
+    iov.data = cmd_fetch;
+    iov.size = 9;
+
+    if (result->connection->store.origin != 0)
+        return db_mysql_result_fetch_batch(result, &iov);
+
+    if (DB_OK != db_mysql_writev(result->connection, 0, &iov, 1))
+        return DB_UNAVAILABLE;
+
+    result->fetch.pending = 1;
+
+    return DB_OK;
+}
+
+/*
+ * Reads next row packet of current resultset, returns DB_NO_DATA
+ * when EOF ends up the rows. Rows of server side cursor are fetched
+ * as needed
+ */
+static int db_mysql_result_next_packet(db_mysql_result_t* result, db_mysql_packet_t* packet)
+{
+    api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
+    unsigned short flags;
+    int code;
+
+    code = db_mysql_result_fetch_more(result);
+    if (DB_OK != code)
+        return code;
+
+    code = db_mysql_read(result->connection, packet);
+    if (DB_OK != code)
+        return code;
+
+    if (PACKET_IS_ERROR(*packet))
+    {
+        db_mysql_parse_error(pool, packet, &result->connection->error);
+        db_mysql_free(result->connection, packet);
+        db_mysql_result_free_columns(result);
+        db_mysql_result_free_rows(result);
+        result->connection->undefined = 1;
+        return DB_FAILED;
+    }
+
+    if (PACKET_IS_EOF(*packet))
+    {
+        flags = *(unsigned short*)(packet->data + 3);
+        db_mysql_free(result->connection, packet);
+
+        if (result->by_fetch)
+        {
+            result->fetch.pending = 0;
+
+            /*
+             * End of fetched batch, cursor still has rows
+             */
+            if (SERVER_STATUS_LAST_ROW_SENT != (SERVER_STATUS_LAST_ROW_SENT & flags))
+                return db_mysql_result_next_packet(result, packet);
+        }
+
+        if (SERVER_MORE_RESULTS_EXISTS == (SERVER_MORE_RESULTS_EXISTS & flags))
+            result->has_more = 1;
+
+        result->rows_done = 1;
+        return DB_NO_DATA;
+    }
+
+    if (result->by_fetch)
+    {
+        result->fetch.rows++;
+        result->fetch.bytes += 4 + packet->size;
+    }
+
+    return DB_OK;
+}
+
+/*
+ * Stops sending of rows which are too many to be skipped
+ */
+static int db_mysql_result_abort(db_mysql_result_t* result)
+{
+    db_mysql_connection_t* connection = result->connection;
+    db_mysql_packet_t packet;
+
+    result->aborted = 1;
+
+    if (DB_MYSQL_ABORT_KILL != (connection->session->flags & DB_MYSQL_ABORT_KILL) ||
+        DB_OK != db_mysql_connection_kill_query(connection))
+    {
+        /*
+         * Rest of response is never read, connection is destroyed on close
+         */
+        connection->undefined = 1;
+        result->rows_done = 1;
+        result->has_more = 0;
+        return DB_UNAVAILABLE;
+    }
+
+    /*
+     * Rows already sent are drained, then response ends with
+     * "Query execution was interrupted" error, or with EOF
+     * if query was done before kill
+     */
+    while (!result->rows_done)
+    {
+        if (DB_OK != db_mysql_read(connection, &packet))
+            return DB_UNAVAILABLE;
+
+        if (PACKET_IS_ERROR(packet))
+        {
+            result->rows_done = 1;
+            result->has_more = 0;
+        }
+        else if (PACKET_IS_EOF(packet))
+        {
+            result->rows_done = 1;
+            result->has_more = SERVER_MORE_RESULTS_EXISTS == (SERVER_MORE_RESULTS_EXISTS & *(short*)(packet.data + 3));
+        }
+
+        db_mysql_free(connection, &packet);
+    }
+
+    return DB_OK;
+}
+
+/*
+ * Drops rest of rows of current resultset without decoding them.
+ * After abort_threshold bytes query is aborted, see db_mysql_result_abort
+ */
+static int db_mysql_result_skip_rows(db_mysql_result_t* result)
+{
+    db_mysql_packet_t packet;
+    int code;
+
+    db_mysql_result_free_rows(result);
+
+    if (result->by_fetch)
+    {
+        /*
+         * Rows of server side cursor are not sent until fetched, so only
+         * rest of pending fetch is drained. Cursor is closed by server
+         * on next execution
+         */
+        while (result->fetch.pending)
+        {
+            if (DB_OK != db_mysql_read(result->connection, &packet))
+                return DB_UNAVAILABLE;
+
+            if (PACKET_IS_ERROR(packet) || PACKET_IS_EOF(packet))
+                result->fetch.pending = 0;
+
+            db_mysql_free(result->connection, &packet);
+        }
+
+        result->rows_done = 1;
+        return DB_OK;
+    }
+
+    while (!result->rows_done)
+    {
+        if (result->connection->session->abort_threshold > 0 &&
+            result->skipped > result->connection->session->abort_threshold &&
+            !result->aborted && !result->connection->store.active)
+        {
+            return db_mysql_result_abort(result);
+        }
+
+        code = db_mysql_result_next_packet(result, &packet);
+        if (DB_NO_DATA == code)
+            break;
+
+        if (DB_OK != code)
+            return code;
+
+        result->skipped += 4 + packet.size;
+        db_mysql_free(result->connection, &packet);
+    }
+
+    return DB_OK;
+}
+
+int db_mysql_eat_result(db_mysql_connection_t* connection)
+{
+    db_column_t* columns;
+    int num_columns;
+    int code = DB_OK;
+
+    if (connection->result == 0)
+        return DB_OK;
+
+    db_mysql_result_join(connection->result);
+
+    if (connection->undefined)
+    {
+        db_mysql_result_destroy(connection->result);
+        connection->result = 0;
+
+        return DB_UNAVAILABLE;
+    }
+
+    if (connection->result->num_columns > 0 && connection->result->columns == 0)
+    {
+        /*
+         * Fetched first resultsets column count
+         */
+    }
+    else if (!connection->result->rows_done)
+    {
+        /*
+         * Called in the middle of rows
+         */
+        code = db_mysql_result_skip_rows(connection->result);
+    }
+
+    /*
+     * eat next resultsets
+     */
+    while (db_result_fetch_columns((db_result_t*)connection->result, &columns, &num_columns) == DB_OK)
+    {
+        if (DB_OK != db_mysql_result_skip_rows(connection->result))
+            break;
+    }
+
+    db_mysql_result_destroy(connection->result);
+    connection->result = 0;
+
+    if (connection->undefined)
         code = DB_UNAVAILABLE;
 
     return code;
@@ -364,6 +832,19 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
     int code = DB_OK;
     int i;
 
+    db_mysql_result_join(result);
+
+    if (result->columns_ready)
+    {
+        /*
+         * Columns of cursor are read on execution
+         */
+        result->columns_ready = 0;
+        *columns = result->columns;
+        *num_columns = result->num_columns;
+        return DB_OK;
+    }
+
     *columns = 0;
     *num_columns = 0;
 
@@ -430,6 +911,7 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
     /*
      * Reset per resultset flags
      */
+    memset(&result->fetch, 0, sizeof(result->fetch));
     result->by_fetch = 0;
     result->rows_done = 0;
     result->has_more = 0;
@@ -446,8 +928,9 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
      * Fetch columns
      */
 
-    result->columns = (db_column_t*)api_calloc(pool, result->num_columns * sizeof(*result->columns));
-    result->mysql_types = (int*)api_calloc(pool, result->num_columns * sizeof(int));
+    result->columns = (db_column_t*)db_arena_alloc(&result->meta, result->num_columns * sizeof(*result->columns));
+    result->mysql_types = (int*)db_arena_alloc(&result->meta, result->num_columns * sizeof(int));
+    memset(result->columns, 0, result->num_columns * sizeof(*result->columns));
 
     i = 0;
     while (i < result->num_columns)
@@ -458,7 +941,7 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
             pos += db_mysql_skip_lenencstr(packet.data + pos); // schema
             pos += db_mysql_skip_lenencstr(packet.data + pos); // table
             pos += db_mysql_skip_lenencstr(packet.data + pos); // org_table
-            pos += db_mysql_read_lenencstr(pool, packet.data + pos, &result->columns[i].name, 0);
+            pos += db_mysql_read_lenencstr_arena(&result->meta, packet.data + pos, &result->columns[i].name, 0);
             pos += db_mysql_skip_lenencstr(packet.data + pos); // org_name
             pos += 1; // 0x0c
             pos += 2; // charset
@@ -484,18 +967,8 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
         /*
          * In case of partial read, cleanup names, and types
          */
-        while (--i >= 0)
-        {
-            if (result->columns[i].name)
-                api_free(pool, strlen(result->columns[i].name) + 1, result->columns[i].name);
-
-            result->columns[i].name = 0;
-        }
-
-        api_free(pool, result->num_columns * sizeof(*result->columns), result->columns);
-        api_free(pool, result->num_columns * sizeof(int), result->mysql_types);
+        db_mysql_result_free_columns(result);
 
-        result->num_columns = 0;
         result->num_rows = 0;
         result->connection->undefined = 1;
         code = DB_UNAVAILABLE;
@@ -533,6 +1006,8 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
 
     if (DB_OK == code)
     {
+        db_mysql_result_build_plan(result);
+
         *num_columns = result->num_columns;
         *columns = result->columns;
     }
@@ -544,26 +1019,72 @@ int db_mysql_result_fetch_columns(db_mysql_result_t* result, db_column_t** colum
     return code;
 }
 
+/*
+ * Helper fiber, reads rows of next batch while caller is busy with
+ * current one. Error and EOF packets are left for db_mysql_result_fetch_rows
+ */
+static void db_mysql_result_read_ahead(api_loop_t* loop, void* arg)
+{
+    db_mysql_result_t* result = (db_mysql_result_t*)arg;
+    db_mysql_connection_t* connection = result->connection;
+    db_mysql_packet_t packet;
+    db_mysql_row_node_t* node;
+    uint64_t bytes = 0;
+    unsigned char code;
+    unsigned int size;
+
+    while (result->ahead.num_rows < result->ahead.count && bytes < connection->session->read_ahead)
+    {
+        result->ahead.code = db_mysql_peek(connection, &code, &size);
+        if (DB_OK != result->ahead.code)
+            break;
+
+        if (PACKET_ERROR == code || (PACKET_EOF == code && size < 9))
+            break;
+
+        result->ahead.code = db_mysql_read(connection, &packet);
+        if (DB_OK != result->ahead.code)
+            break;
+
+        node = (db_mysql_row_node_t*)db_arena_alloc(&result->arena, sizeof(*node));
+        node->row = db_mysql_result_read_row(result, &packet);
+        api_list_push_tail(&result->ahead.list, (api_node_t*)node);
+
+        ++result->ahead.num_rows;
+        bytes += 4 + packet.size;
+
+        db_mysql_free(connection, &packet);
+    }
+
+    result->ahead.running = 0;
+    api_event_signal(&result->ahead.done, loop);
+}
+
+void db_mysql_result_join(db_mysql_result_t* result)
+{
+    while (result->ahead.running)
+        api_event_wait(&result->ahead.done, 0);
+}
+
 int db_mysql_result_fetch_rows(db_mysql_result_t* result, db_value_t*** rows, int* count)
 {
-    api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
+    api_loop_t* loop = result->connection->session->base.loop;
     db_mysql_packet_t packet;
     api_list_t list;
     db_mysql_row_node_t* node;
-    char cmd_fetch[4 + 9];
+    db_arena_t arena;
     int code = DB_OK;
     int nrow = 0;
     int i;
 
     *rows = 0;
 
-    list.head = 0;
-    list.tail = 0;
+    db_mysql_result_join(result);
 
-    if (result->connection->undefined)
+    if (result->connection->undefined && result->ahead.num_rows == 0)
     {
         /*
-         * Connection in invalid state
+         * Connection in invalid state, and no rows were read before
          */
         return DB_UNKNOWN;
     }
@@ -582,90 +1103,1422 @@ int db_mysql_result_fetch_rows(db_mysql_result_t* result, db_value_t*** rows, in
     }
 
     /*
-     * Free previous rows
+     * Free previous rows, but keep rows read ahead
      */
-    db_mysql_result_free_rows(result);
+    list = result->ahead.list;
+    nrow = result->ahead.num_rows;
+    code = result->ahead.code;
 
-    /*
-     * If Fetch needed, then send CMD_STM_FETCH command
-     */
-    if (result->by_fetch)
+    if (nrow == 0)
     {
-        *(int*)cmd_fetch = 9;
-        cmd_fetch[4] = COM_STMT_FETCH;
-        *(int*)(cmd_fetch + 5) = result->statement_id;
-        *(int*)(cmd_fetch + 9) = *count;
-
-        if (4 + 9 != api_stream_write(&result->connection->tcp.stream, cmd_fetch, 4 + 9))
-        {
-            db_mysql_result_free_columns(result);
-            db_mysql_result_free_rows(result);
-            result->connection->undefined = 1;
-            return DB_UNAVAILABLE;
-        }
+        db_mysql_result_free_rows(result);
+    }
+    else
+    {
+        db_arena_reset(&result->spare);
+        result->rows = 0;
+        result->num_rows = 0;
     }
 
-    nrow = 0;
-    while (*count == 0 || nrow < *count)
+    result->ahead.code = DB_OK;
+    result->ahead.num_rows = 0;
+    result->ahead.list.head = 0;
+    result->ahead.list.tail = 0;
+
+    if (DB_OK != code && nrow > 0)
     {
-        code = db_mysql_read(result->connection, &packet);
-        if (DB_OK != code)
-        {
-            break;
-        }
+        /*
+         * Connection failed while reading ahead, rows read before failure
+         * are returned and error is left for the next call
+         */
+        result->ahead.code = code;
+        code = DB_OK;
+    }
 
-        if (PACKET_IS_ERROR(packet))
+    while (DB_OK == code && DB_OK == result->ahead.code && (*count == 0 || nrow < *count))
+    {
+        code = db_mysql_result_next_packet(result, &packet);
+        if (DB_NO_DATA == code)
         {
-            db_mysql_parse_error(pool, &packet, &result->connection->error);
-            db_mysql_free(result->connection, &packet);
-            db_mysql_result_free_columns(result);
-            db_mysql_result_free_rows(result);
-            result->connection->undefined = 1;
-            code = DB_FAILED;
+            code = DB_OK;
             break;
         }
 
-        if (PACKET_IS_EOF(packet))
+        if (DB_OK != code)
         {
-            //if (SERVER_STATUS_LAST_ROW_SENT == (SERVER_STATUS_LAST_ROW_SENT & *(short*)(packet.data + 3)))
-            //    result->rows_done = 1;
-
-            if (SERVER_MORE_RESULTS_EXISTS == (SERVER_MORE_RESULTS_EXISTS & *(short*)(packet.data + 3)))
-                result->has_more = 1;
-            
-            db_mysql_free(result->connection, &packet);
-            result->rows_done = 1;
-            code = DB_OK;
             break;
         }
 
-        node = (db_mysql_row_node_t*)api_alloc(pool, sizeof(*node));
+        node = (db_mysql_row_node_t*)db_arena_alloc(&result->arena, sizeof(*node));
         node->row = db_mysql_result_read_row(result, &packet);
         api_list_push_tail(&list, (api_node_t*)node);
 
         ++nrow;
-        db_mysql_free(result->connection, &packet);
+
+        if (result->zero_copy)
+            db_mysql_retain(result->connection, &packet);
+        else
+            db_mysql_free(result->connection, &packet);
+    }
+
+    if (result->columns == 0)
+    {
+        /*
+         * Rows was freed on error
+         */
+        nrow = 0;
     }
 
     if (nrow > 0)
     {
-        result->rows = (db_value_t**)api_calloc(pool, nrow * sizeof(db_value_t*));
+        result->rows = (db_value_t**)db_arena_alloc(&result->arena, nrow * sizeof(db_value_t*));
         for (i = 0; i < nrow; ++i)
         {
             node = (db_mysql_row_node_t*)api_list_pop_head(&list);
             result->rows[i] = node->row;
-
-            api_free(pool, sizeof(*node), node);
         }
+
+        result->num_rows = nrow;
+    }
+
+    /*
+     * Rows being returned move to spare, arena is left for the next batch
+     */
+    arena = result->spare;
+    result->spare = result->arena;
+    result->arena = arena;
+
+    if (DB_OK == code && DB_OK == result->ahead.code && !result->rows_done && *count > 0 && result->connection->session->read_ahead > 0 &&
+        !result->by_fetch && !result->zero_copy && !result->connection->store.active)
+    {
+        result->ahead.count = *count;
+        result->ahead.running = 1;
+        api_event_init(&result->ahead.done, loop);
+
+        if (API_OK != api_loop_post(loop, db_mysql_result_read_ahead, result, DB_MYSQL_AHEAD_STACK))
+            result->ahead.running = 0;
+    }
+
+    *rows = result->rows;
+    *count = nrow;
+
+    return code;
+}
+
+int db_mysql_result_fetch_lazy(db_mysql_result_t* result, db_mysql_row_t*** rows, int* count)
+{
+    db_mysql_packet_t packet;
+    db_mysql_row_t** list = 0;
+    db_mysql_row_t** grown;
+    db_mysql_row_t* row;
+    int capacity = 0;
+    int max = *count;
+    int nrow = 0;
+    int code;
+
+    db_mysql_result_join(result);
+
+    *rows = 0;
+    *count = 0;
+
+    if (result->connection->undefined)
+    {
+        /*
+         * Connection in invalid state
+         */
+        return DB_UNKNOWN;
+    }
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (result->rows_done)
+        return DB_NO_DATA;
+
+    if (result->ahead.num_rows > 0)
+    {
+        /*
+         * Rows read ahead are handed out by db_result_fetch_rows only
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    /*
+     * Free previous batch
+     */
+    db_mysql_result_free_rows(result);
+
+    while (max == 0 || nrow < max)
+    {
+        code = db_mysql_result_next_packet(result, &packet);
+        if (DB_NO_DATA == code)
+        {
+            code = DB_OK;
+            break;
+        }
+
+        if (DB_OK != code)
+        {
+            /*
+             * Batch was released with the rest of result
+             */
+            return code;
+        }
+
+        if (nrow == capacity)
+        {
+            capacity = capacity > 0 ? 2 * capacity : 64;
+            grown = (db_mysql_row_t**)db_arena_alloc(&result->arena, capacity * sizeof(db_mysql_row_t*));
+
+            if (nrow > 0)
+                memcpy(grown, list, nrow * sizeof(db_mysql_row_t*));
+
+            list = grown;
+        }
+
+        /*
+         * Keep raw packet only, values are decoded on access
+         */
+        row = (db_mysql_row_t*)db_arena_alloc(&result->arena, sizeof(db_mysql_row_t));
+        row->result = result;
+        row->offsets = 0;
+        row->indexed = 0;
+        row->cursor = result->statement_id > 0 ? 1 + result->bitmap_size : 0;
+
+        if (result->zero_copy)
+        {
+            row->data = packet.data;
+            db_mysql_retain(result->connection, &packet);
+        }
+        else
+        {
+            row->data = (char*)db_arena_alloc(&result->arena, packet.size);
+            memcpy(row->data, packet.data, packet.size);
+            db_mysql_free(result->connection, &packet);
+        }
+
+        list[nrow++] = row;
+    }
+
+    *rows = list;
+    *count = nrow;
+
+    return code;
+}
+
+#define DB_MYSQL_NULL_OFFSET 0xffffffff
+
+int db_mysql_row_get(db_mysql_row_t* row, int column, db_value_t* value)
+{
+    db_mysql_result_t* result = row->result;
+    uint64_t count;
+    uint64_t length;
+    unsigned char* bitmap = (unsigned char*)row->data + 1;
+    char* pos;
+    int size;
+    int i;
+
+    if (column < 0 || column >= result->num_columns)
+        return DB_OUT_OF_INDEX;
+
+    if (row->offsets == 0)
+        row->offsets = (uint32_t*)db_arena_alloc(&result->arena, result->num_columns * sizeof(uint32_t));
+
+    /*
+     * Extend offset index up to requested column
+     */
+    while (row->indexed <= column)
+    {
+        i = row->indexed;
+        pos = row->data + row->cursor;
+
+        if (result->statement_id > 0)
+        {
+            if ((bitmap[result->plan[i].null_byte] >> result->plan[i].null_shift) & 1)
+            {
+                /*
+                 * Null values are not present in binary rows
+                 */
+                row->offsets[i] = DB_MYSQL_NULL_OFFSET;
+            }
+            else
+            {
+                row->offsets[i] = row->cursor;
+
+                size = db_mysql_fixed_size(result->columns[i].type);
+                if (size == 0)
+                {
+                    switch (result->columns[i].type)
+                    {
+                    case DB_TYPE_TIME:
+                    case DB_TYPE_DATE:
+                    case DB_TYPE_DATETIME:
+                    case DB_TYPE_TIMESTAMP:
+                        size = 1 + (unsigned char)*pos;
+                        break;
+                    default:
+                        length = db_mysql_read_lenencint(pos, &count);
+                        size = (int)(count + length);
+                        break;
+                    }
+                }
+
+                row->cursor += size;
+            }
+        }
+        else
+        {
+            if ((unsigned char)*pos == 0xfb)
+            {
+                row->offsets[i] = DB_MYSQL_NULL_OFFSET;
+                row->cursor += 1;
+            }
+            else
+            {
+                row->offsets[i] = row->cursor;
+
+                length = db_mysql_read_lenencint(pos, &count);
+                row->cursor += (uint32_t)(count + length);
+            }
+        }
+
+        ++row->indexed;
+    }
+
+    memset(value, 0, sizeof(*value));
+
+    if (row->offsets[column] == DB_MYSQL_NULL_OFFSET)
+    {
+        value->is_null = 1;
+        return DB_OK;
+    }
+
+    /*
+     * Strings are allocated from rows arena, and live as the row
+     */
+    result->plan[column].decode(&result->arena, row->data + row->offsets[column], value);
+
+    return DB_OK;
+}
+
+/*
+ * Returns size of vector element for fixed size types, 0 for strings and binaries
+ */
+static size_t db_mysql_vector_width(int type)
+{
+    switch (type)
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        return sizeof(char);
+    case DB_TYPE_SHORT:
+        return sizeof(short);
+    case DB_TYPE_INT:
+        return sizeof(int);
+    case DB_TYPE_INT64:
+        return sizeof(int64_t);
+    case DB_TYPE_FLOAT:
+        return sizeof(float);
+    case DB_TYPE_DOUBLE:
+        return sizeof(double);
+    case DB_TYPE_TIME:
+        return sizeof(db_time_t);
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        return sizeof(db_date_t);
+    }
+
+    return 0;
+}
+
+/*
+ * Grows vectors to hold capacity rows. Buffers are taken from rows arena,
+ * outgrown ones stay there until batch is released
+ */
+static void db_mysql_vectors_grow(db_mysql_result_t* result, db_vector_t* vectors, int used, int capacity)
+{
+    size_t width;
+    void* values;
+    uint64_t* offsets;
+    unsigned char* validity;
+    int i;
+
+    for (i = 0; i < result->num_columns; ++i)
+    {
+        validity = (unsigned char*)db_arena_alloc(&result->arena, (capacity + 7) / 8);
+        memset(validity, 0, (capacity + 7) / 8);
+
+        if (used > 0)
+            memcpy(validity, vectors[i].validity, (used + 7) / 8);
+
+        vectors[i].validity = validity;
+
+        width = db_mysql_vector_width(vectors[i].type);
+        if (width > 0)
+        {
+            values = db_arena_alloc(&result->arena, width * capacity);
+
+            if (used > 0)
+                memcpy(values, vectors[i].values, width * used);
+
+            vectors[i].values = values;
+        }
+        else
+        {
+            offsets = (uint64_t*)db_arena_alloc(&result->arena, (capacity + 1) * sizeof(uint64_t));
+
+            if (used > 0)
+                memcpy(offsets, vectors[i].offsets, (used + 1) * sizeof(uint64_t));
+            else
+                offsets[0] = 0;
+
+            vectors[i].offsets = offsets;
+        }
+    }
+}
+
+/*
+ * Appends bytes of string value, data buffer grows twice when full
+ */
+static void db_mysql_vector_append_data(db_mysql_result_t* result, db_vector_t* vector, uint64_t* capacity, int row, const char* data, uint64_t size)
+{
+    uint64_t used = vector->offsets[row];
+    char* buffer;
+
+    if (used + size > *capacity)
+    {
+        *capacity = *capacity > 0 ? 2 * *capacity : 1024;
+        if (*capacity < used + size)
+            *capacity = used + size;
+
+        buffer = (char*)db_arena_alloc(&result->arena, (size_t)*capacity);
+
+        if (used > 0)
+            memcpy(buffer, vector->data, (size_t)used);
+
+        vector->data = buffer;
+    }
+
+    memcpy(vector->data + used, data, (size_t)size);
+    vector->offsets[row + 1] = used + size;
+}
+
+/*
+ * Stores decoded value into vector. Text protocol decodes all integers as int64
+ */
+static void db_mysql_vector_store(db_vector_t* vector, int row, db_value_t* value, int is_text)
+{
+    switch (vector->type)
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        ((char*)vector->values)[row] = is_text ? (char)value->value_int64 : value->value_byte;
+        break;
+    case DB_TYPE_SHORT:
+        ((short*)vector->values)[row] = is_text ? (short)value->value_int64 : value->value_short;
+        break;
+    case DB_TYPE_INT:
+        ((int*)vector->values)[row] = is_text ? (int)value->value_int64 : value->value_int;
+        break;
+    case DB_TYPE_INT64:
+        ((int64_t*)vector->values)[row] = value->value_int64;
+        break;
+    case DB_TYPE_FLOAT:
+        ((float*)vector->values)[row] = value->value_float;
+        break;
+    case DB_TYPE_DOUBLE:
+        ((double*)vector->values)[row] = value->value_double;
+        break;
+    case DB_TYPE_TIME:
+        ((db_time_t*)vector->values)[row] = value->value_time;
+        break;
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        ((db_date_t*)vector->values)[row] = value->value_date;
+        break;
+    }
+}
+
+/*
+ * Decodes row packet directly into vectors
+ */
+static void db_mysql_vectors_append(db_mysql_result_t* result, db_vector_t* vectors, uint64_t* capacities, int row, db_mysql_packet_t* packet)
+{
+    db_value_t value;
+    unsigned char* bitmap = 0;
+    char* pos;
+    uint64_t count;
+    uint64_t length;
+    int is_null;
+    int i;
+
+    if (result->statement_id > 0)
+    {
+        bitmap = (unsigned char*)packet->data + 1;
+        pos = packet->data + 1 + result->bitmap_size;
+    }
+    else
+    {
+        pos = packet->data;
+    }
+
+    for (i = 0; i < result->num_columns; ++i)
+    {
+        if (bitmap != 0)
+            is_null = (bitmap[result->plan[i].null_byte] >> result->plan[i].null_shift) & 1;
+        else
+            is_null = (unsigned char)*pos == 0xfb;
+
+        if (is_null)
+        {
+            if (bitmap == 0)
+                ++pos;
+
+            if (vectors[i].offsets != 0)
+                vectors[i].offsets[row + 1] = vectors[i].offsets[row];
+
+            continue;
+        }
+
+        vectors[i].validity[row / 8] |= (unsigned char)(1 << (row % 8));
+
+        if (vectors[i].offsets != 0)
+        {
+            /*
+             * Strings and binaries are copied from packet as is
+             */
+            length = db_mysql_read_lenencint(pos, &count);
+            db_mysql_vector_append_data(result, vectors + i, capacities + i, row, pos + count, length);
+            pos += count + length;
+        }
+        else
+        {
+            memset(&value, 0, sizeof(value));
+
+            pos += result->plan[i].decode(&result->arena, pos, &value);
+            db_mysql_vector_store(vectors + i, row, &value, bitmap == 0);
+        }
+    }
+}
+
+int db_mysql_result_fetch_vectors(db_mysql_result_t* result, db_vector_t** vectors, int* count)
+{
+    db_mysql_packet_t packet;
+    db_vector_t* batch;
+    uint64_t* capacities;
+    int capacity = 0;
+    int max = *count;
+    int nrow = 0;
+    int code;
+    int i;
+
+    db_mysql_result_join(result);
+
+    *vectors = 0;
+    *count = 0;
+
+    if (result->connection->undefined)
+    {
+        /*
+         * Connection in invalid state
+         */
+        return DB_UNKNOWN;
+    }
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (result->rows_done)
+        return DB_NO_DATA;
+
+    if (result->ahead.num_rows > 0)
+    {
+        /*
+         * Rows read ahead are handed out by db_result_fetch_rows only
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    /*
+     * Free previous batch
+     */
+    db_mysql_result_free_rows(result);
+
+    batch = (db_vector_t*)db_arena_alloc(&result->arena, result->num_columns * sizeof(db_vector_t));
+    capacities = (uint64_t*)db_arena_alloc(&result->arena, result->num_columns * sizeof(uint64_t));
+
+    memset(batch, 0, result->num_columns * sizeof(db_vector_t));
+    memset(capacities, 0, result->num_columns * sizeof(uint64_t));
+
+    for (i = 0; i < result->num_columns; ++i)
+        batch[i].type = result->columns[i].type;
+
+    while (max == 0 || nrow < max)
+    {
+        code = db_mysql_result_next_packet(result, &packet);
+        if (DB_NO_DATA == code)
+        {
+            code = DB_OK;
+            break;
+        }
+
+        if (DB_OK != code)
+        {
+            /*
+             * Batch was released with the rest of result
+             */
+            return code;
+        }
+
+        if (nrow == capacity)
+        {
+            capacity = capacity > 0 ? 2 * capacity : 64;
+            if (max > 0 && capacity > max)
+                capacity = max;
+
+            db_mysql_vectors_grow(result, batch, nrow, capacity);
+        }
+
+        db_mysql_vectors_append(result, batch, capacities, nrow, &packet);
+        db_mysql_free(result->connection, &packet);
+
+        ++nrow;
+    }
+
+    if (capacity == 0)
+    {
+        /*
+         * Empty batch still has valid buffers and offsets[0]
+         */
+        db_mysql_vectors_grow(result, batch, 0, 1);
+    }
+
+    for (i = 0; i < result->num_columns; ++i)
+        batch[i].count = nrow;
+
+    *vectors = batch;
+    *count = nrow;
+
+    return code;
+}
+
+int db_mysql_result_next_row(db_mysql_result_t* result, db_value_t** row)
+{
+    db_mysql_packet_t packet;
+    int code;
+
+    db_mysql_result_join(result);
+
+    *row = 0;
+
+    if (result->connection->undefined)
+    {
+        /*
+         * Connection in invalid state
+         */
+        return DB_UNKNOWN;
+    }
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (result->rows_done)
+        return DB_NO_DATA;
+
+    if (result->ahead.num_rows > 0)
+    {
+        /*
+         * Rows read ahead are handed out by db_result_fetch_rows only
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    db_mysql_result_free_rows(result);
+
+    code = db_mysql_result_next_packet(result, &packet);
+    if (DB_OK != code)
+        return code;
+
+    if (result->row == 0)
+        result->row = (db_value_t*)db_arena_alloc(&result->meta, result->num_columns * sizeof(db_value_t));
+
+    /*
+     * Strings of previous row were released by free_rows, arena
+     * reuses the same chunks, so that usual rows need no allocation
+     */
+    db_mysql_result_parse_row(result, result->plan, &packet, result->row);
+
+    if (result->zero_copy)
+        db_mysql_retain(result->connection, &packet);
+    else
+        db_mysql_free(result->connection, &packet);
+
+    *row = result->row;
+
+    return DB_OK;
+}
+
+int db_mysql_result_fetch_rowset(db_mysql_result_t* result, db_rowset_t** rowset, int* count)
+{
+    api_pool_t* pool = api_pool_default(result->connection->session->base.loop);
+    db_value_t* row;
+    int max = *count;
+    int code = DB_OK;
+
+    *rowset = 0;
+    *count = 0;
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    /*
+     * Rows are decoded into reused row and packed into rowset,
+     * which is owned by caller and outlives the result
+     */
+    *rowset = db_rowset_create(pool, result->columns, result->num_columns);
+
+    while (max == 0 || (*rowset)->num_rows < max)
+    {
+        code = db_mysql_result_next_row(result, &row);
+        if (DB_OK != code)
+            break;
+
+        db_rowset_append(*rowset, row, result->statement_id == 0 /* text protocol */);
+    }
+
+    if (DB_NO_DATA == code && (*rowset)->num_rows > 0)
+        code = DB_OK;
+
+    if (DB_OK != code)
+    {
+        db_rowset_free(*rowset);
+        *rowset = 0;
+        return code;
+    }
+
+    *count = (*rowset)->num_rows;
+
+    return code;
+}
+
+int db_mysql_result_fetch_each(db_mysql_result_t* result, db_row_fn fn, void* arg)
+{
+    db_value_t* row;
+    int code;
+
+    while (DB_OK == (code = db_mysql_result_next_row(result, &row)))
+    {
+        if (0 != fn(arg, row, result->num_columns))
+        {
+            /*
+             * Stopped by callback, rest of rows remain readable
+             */
+            return DB_OK;
+        }
+    }
+
+    return DB_NO_DATA == code ? DB_OK : code;
+}
+
+/*
+ * Integer and floating point columns converted to caller's type
+ */
+static int64_t db_mysql_value_integer(db_value_t* value, int type)
+{
+    switch (type)
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        return value->value_byte;
+    case DB_TYPE_SHORT:
+        return value->value_short;
+    case DB_TYPE_INT:
+        return value->value_int;
+    case DB_TYPE_FLOAT:
+        return (int64_t)value->value_float;
+    case DB_TYPE_DOUBLE:
+        return (int64_t)value->value_double;
+    }
+
+    return value->value_int64;
+}
+
+static double db_mysql_value_real(db_value_t* value, int type)
+{
+    switch (type)
+    {
+    case DB_TYPE_FLOAT:
+        return value->value_float;
+    case DB_TYPE_DOUBLE:
+        return value->value_double;
+    }
+
+    return (double)db_mysql_value_integer(value, type);
+}
+
+static void db_mysql_store_byte(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *dest = value->is_null ? 0 : (char)db_mysql_value_integer(value, type);
+}
+
+static void db_mysql_store_short(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *(short*)dest = value->is_null ? 0 : (short)db_mysql_value_integer(value, type);
+}
+
+static void db_mysql_store_int(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *(int*)dest = value->is_null ? 0 : (int)db_mysql_value_integer(value, type);
+}
+
+static void db_mysql_store_int64(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *(int64_t*)dest = value->is_null ? 0 : db_mysql_value_integer(value, type);
+}
+
+static void db_mysql_store_float(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *(float*)dest = value->is_null ? 0 : (float)db_mysql_value_real(value, type);
+}
+
+static void db_mysql_store_double(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    *(double*)dest = value->is_null ? 0 : db_mysql_value_real(value, type);
+}
+
+static void db_mysql_store_time(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    if (value->is_null)
+        memset(dest, 0, sizeof(db_time_t));
+    else
+        *(db_time_t*)dest = value->value_time;
+}
+
+static void db_mysql_store_date(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    if (value->is_null)
+        memset(dest, 0, sizeof(db_date_t));
+    else
+        *(db_date_t*)dest = value->value_date;
+}
+
+/*
+ * Strings are cut to fit with '\0', binaries just cut
+ */
+static void db_mysql_store_bytes(db_binding_t* binding, char* dest, db_value_t* value, int type)
+{
+    uint64_t capacity = binding->type == DB_TYPE_STRING ? binding->size - 1 : binding->size;
+    uint64_t size = value->is_null ? 0 : value->size;
+
+    if (size > capacity)
+        size = capacity;
+
+    if (size > 0)
+        memcpy(dest, value->value_binary, (size_t)size);
+
+    if (binding->type == DB_TYPE_STRING)
+        dest[size] = 0;
+}
+
+static db_mysql_store_fn db_mysql_store(int type, int column_type)
+{
+    int is_number = column_type >= DB_TYPE_BOOL && column_type <= DB_TYPE_DOUBLE;
+    int is_date = column_type == DB_TYPE_DATE || column_type == DB_TYPE_DATETIME || column_type == DB_TYPE_TIMESTAMP;
+    int is_bytes = column_type == DB_TYPE_STRING || column_type == DB_TYPE_BINARY;
+
+    switch (type)
+    {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        return is_number ? db_mysql_store_byte : 0;
+    case DB_TYPE_SHORT:
+        return is_number ? db_mysql_store_short : 0;
+    case DB_TYPE_INT:
+        return is_number ? db_mysql_store_int : 0;
+    case DB_TYPE_INT64:
+        return is_number ? db_mysql_store_int64 : 0;
+    case DB_TYPE_FLOAT:
+        return is_number ? db_mysql_store_float : 0;
+    case DB_TYPE_DOUBLE:
+        return is_number ? db_mysql_store_double : 0;
+    case DB_TYPE_TIME:
+        return column_type == DB_TYPE_TIME ? db_mysql_store_time : 0;
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        return is_date ? db_mysql_store_date : 0;
+    case DB_TYPE_STRING:
+    case DB_TYPE_BINARY:
+        return is_bytes ? db_mysql_store_bytes : 0;
+    }
+
+    return 0;
+}
+
+int db_mysql_result_bind(db_mysql_result_t* result, db_binding_t* bindings, int count)
+{
+    db_mysql_column_plan_t* plan;
+    db_mysql_bound_t* bound;
+    int is_binary = result->statement_id > 0;
+    int i;
+
+    db_mysql_result_join(result);
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (count != result->num_columns)
+        return DB_OUT_OF_INDEX;
+
+    bound = (db_mysql_bound_t*)db_arena_alloc(&result->meta, count * sizeof(*bound));
+    plan = (db_mysql_column_plan_t*)db_arena_alloc(&result->meta, count * sizeof(*plan));
+
+    for (i = 0; i < count; ++i)
+    {
+        bound[i].binding = bindings[i];
+        bound[i].store = 0;
+
+        /*
+         * Values are decoded in place, and copied once into caller's memory
+         */
+        plan[i] = result->plan[i];
+        plan[i].decode = db_mysql_decoder(result->columns[i].type, is_binary, 1 /* zero copy */);
+
+        if (bindings[i].type == 0)
+            continue;
+
+        bound[i].store = db_mysql_store(bindings[i].type, result->columns[i].type);
+
+        if (bound[i].store == 0 ||
+            ((bindings[i].type == DB_TYPE_STRING || bindings[i].type == DB_TYPE_BINARY) && bindings[i].size == 0))
+        {
+            return DB_MISMATCH;
+        }
+    }
+
+    result->bound = bound;
+    result->bound_plan = plan;
+
+    if (result->row == 0)
+        result->row = (db_value_t*)db_arena_alloc(&result->meta, count * sizeof(db_value_t));
+
+    return DB_OK;
+}
+
+int db_mysql_result_fetch_bound(db_mysql_result_t* result, int* count)
+{
+    db_mysql_bound_t* binding;
+    db_mysql_packet_t packet;
+    db_value_t* value;
+    size_t offset;
+    int max = *count;
+    int nrow = 0;
+    int code = DB_OK;
+    int i;
+
+    db_mysql_result_join(result);
+
+    *count = 0;
+
+    if (result->connection->undefined)
+    {
+        /*
+         * Connection in invalid state
+         */
+        return DB_UNKNOWN;
+    }
+
+    if (result->bound == 0)
+    {
+        /*
+         * First db_result_bind must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (result->rows_done)
+        return DB_NO_DATA;
+
+    if (result->ahead.num_rows > 0)
+    {
+        /*
+         * Rows read ahead are handed out by db_result_fetch_rows only
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    db_mysql_result_free_rows(result);
+
+    while (nrow < max)
+    {
+        code = db_mysql_result_next_packet(result, &packet);
+        if (DB_NO_DATA == code)
+        {
+            code = DB_OK;
+            break;
+        }
+
+        if (DB_OK != code)
+            break;
+
+        /*
+         * Scratch row is reused, temporal values must not keep fields of previous row
+         */
+        memset(result->row, 0, result->num_columns * sizeof(db_value_t));
+        db_mysql_result_parse_row(result, result->bound_plan, &packet, result->row);
+
+        for (i = 0; i < result->num_columns; ++i)
+        {
+            binding = &result->bound[i];
+            if (binding->store == 0)
+                continue;
+
+            value = result->row + i;
+            offset = nrow * binding->binding.stride;
+
+            binding->store(&binding->binding, (char*)binding->binding.data + offset, value, result->columns[i].type);
+
+            if (binding->binding.is_null != 0)
+                binding->binding.is_null[offset] = (char)value->is_null;
+
+            if (binding->binding.length != 0 && binding->store == db_mysql_store_bytes)
+                *(uint64_t*)((char*)binding->binding.length + offset) = value->is_null ? 0 : value->size;
+        }
+
+        db_mysql_free(result->connection, &packet);
+        ++nrow;
     }
 
-    *rows = result->rows;
     *count = nrow;
 
     return code;
 }
 
+static void db_mysql_row_stream_feed(void* arg, char* data, size_t length)
+{
+    db_mysql_row_stream_t* stream = (db_mysql_row_stream_t*)arg;
+    db_mysql_result_t* result = stream->result;
+    unsigned char first;
+    uint64_t count;
+    size_t n;
+    int need;
+
+    while (length > 0 && stream->index < result->num_columns)
+    {
+        if (stream->header_done < stream->header_size)
+        {
+            /*
+             * Binary protocol, collect null bitmap after the packet code
+             */
+            n = stream->header_size - stream->header_done;
+            if (n > length)
+                n = length;
+
+            while (n-- > 0)
+            {
+                if (stream->header_done > 0)
+                    stream->bitmap[stream->header_done - 1] = *data;
+
+                ++stream->header_done;
+                ++data;
+                --length;
+            }
+
+            continue;
+        }
+
+        if (!stream->in_value)
+        {
+            if (result->statement_id > 0)
+            {
+                if (0 != (stream->bitmap[(stream->index + 2) / 8] & (1 << ((stream->index + 2) % 8))))
+                {
+                    /*
+                     * Null values are not present in binary rows
+                     */
+                    ++stream->index;
+                    continue;
+                }
+
+                stream->remaining = db_mysql_fixed_size(result->columns[stream->index].type);
+                stream->in_value = stream->remaining > 0;
+            }
+
+            if (!stream->in_value)
+            {
+                stream->prefix[stream->prefix_size++] = *data++;
+                --length;
+
+                first = (unsigned char)stream->prefix[0];
+                need = first < 0xfc ? 1 : (first == 0xfc ? 3 : (first == 0xfd ? 4 : 9));
+
+                if (stream->prefix_size < need)
+                    continue;
+
+                stream->prefix_size = 0;
+
+                if (first == 0xfb)
+                {
+                    /*
+                     * Text protocol null
+                     */
+                    ++stream->index;
+                    continue;
+                }
+
+                stream->remaining = db_mysql_read_lenencint(stream->prefix, &count);
+                stream->in_value = 1;
+            }
+        }
+
+        n = stream->remaining < length ? (size_t)stream->remaining : length;
+
+        if (n > 0 && stream->index == stream->column)
+            stream->fn(stream->arg, data, n);
+
+        data += n;
+        length -= n;
+        stream->remaining -= n;
+
+        if (stream->remaining == 0)
+        {
+            if (stream->index == stream->column)
+                stream->is_null = 0;
+
+            stream->in_value = 0;
+            ++stream->index;
+        }
+    }
+}
+
+int db_mysql_result_fetch_stream(db_mysql_result_t* result, int column, db_write_fn fn, void* arg, int* is_null)
+{
+    db_mysql_row_stream_t stream;
+    db_mysql_packet_t packet;
+    unsigned char code;
+    unsigned int size;
+    int error;
+
+    db_mysql_result_join(result);
+
+    *is_null = 1;
+
+    if (result->connection->undefined)
+    {
+        /*
+         * Connection in invalid state
+         */
+        return DB_UNKNOWN;
+    }
+
+    if (result->columns == 0)
+    {
+        /*
+         * Firt db_result_fetch_columns must be called
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    if (column < 0 || column >= result->num_columns)
+        return DB_OUT_OF_INDEX;
+
+    if (result->rows_done)
+        return DB_NO_DATA;
+
+    if (result->ahead.num_rows > 0)
+    {
+        /*
+         * Rows read ahead are handed out by db_result_fetch_rows only
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    db_mysql_result_free_rows(result);
+
+    error = db_mysql_result_fetch_more(result);
+    if (DB_OK != error)
+        return error;
+
+    error = db_mysql_peek(result->connection, &code, &size);
+    if (DB_OK != error)
+        return error;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.result = result;
+    stream.column = column;
+    stream.fn = fn;
+    stream.arg = arg;
+    stream.is_null = 1;
+
+    if (result->statement_id > 0)
+        stream.header_size = 1 + (result->num_columns + 7 + 2) / 8;
+
+    if (code == PACKET_ERROR || (code == PACKET_EOF && size < 9))
+    {
+        /*
+         * Not a row, read as usual. Cursor may go on with next fetch,
+         * then its first row is passed as a whole
+         */
+        error = db_mysql_result_next_packet(result, &packet);
+        if (DB_OK != error)
+            return error;
+
+        db_mysql_row_stream_feed(&stream, packet.data, packet.size);
+        db_mysql_free(result->connection, &packet);
+    }
+    else
+    {
+        error = db_mysql_read_stream(result->connection, db_mysql_row_stream_feed, &stream);
+    }
+
+    *is_null = stream.is_null;
+
+    return error;
+}
+
+static db_mysql_connection_t* db_mysql_result_detached_create(db_mysql_connection_t* connection)
+{
+    api_pool_t* pool = api_pool_default(connection->session->base.loop);
+    db_mysql_connection_t* detached;
+
+    detached = (db_mysql_connection_t*)api_calloc(pool, sizeof(*detached));
+    detached->session = connection->session;
+    detached->store.active = 1;
+
+    return detached;
+}
+
+/*
+ * Result moves to detached connection, which replays stored packets,
+ * so connection is free for other commands
+ */
+static void db_mysql_result_detach(db_mysql_result_t* result, db_mysql_connection_t* detached)
+{
+    result->connection->result = 0;
+    detached->result = result;
+    result->connection = detached;
+}
+
+/*
+ * Copies packets of current response to detached connection until its end.
+ * Returns 1 when more packets follow, 0 at the end, or -1 on failure
+ */
+static int db_mysql_result_store_packet(db_mysql_connection_t* connection, db_mysql_connection_t* detached, int* stage, int statement_id)
+{
+    db_mysql_packet_t packet;
+    db_mysql_iovec_t iov;
+    char cmd_fetch[9];
+    unsigned short flags;
+    uint64_t pos;
+    uint64_t count;
+    int by_fetch = 0;
+    int result = 1;
+
+    if (DB_OK != db_mysql_read(connection, &packet))
+        return -1;
+
+    if (PACKET_IS_ERROR(packet))
+    {
+        result = 0;
+    }
+    else if (*stage == 0)
+    {
+        /*
+         * Column definitions, up to EOF
+         */
+        if (PACKET_IS_EOF(packet))
+        {
+            flags = *(unsigned short*)(packet.data + 3);
+            if (SERVER_STATUS_CURSOR_EXISTS == (flags & SERVER_STATUS_CURSOR_EXISTS))
+            {
+                /*
+                 * Replay as if rows follow columns directly
+                 */
+                flags &= ~SERVER_STATUS_CURSOR_EXISTS;
+                *(unsigned short*)(packet.data + 3) = flags;
+                by_fetch = 1;
+            }
+
+            *stage = 1;
+        }
+    }
+    else if (*stage == 1)
+    {
+        /*
+         * Rows, up to EOF
+         */
+        if (PACKET_IS_EOF(packet))
+        {
+            flags = *(unsigned short*)(packet.data + 3);
+            if (SERVER_MORE_RESULTS_EXISTS == (flags & SERVER_MORE_RESULTS_EXISTS))
+                *stage = 2;
+            else
+                result = 0;
+        }
+    }
+    else if (PACKET_IS_OK(packet))
+    {
+        /*
+         * Next resultset without rows, flags follow affected rows and insert id
+         */
+        pos = 1;
+        db_mysql_read_lenencint(packet.data + pos, &count);
+        pos += count;
+        db_mysql_read_lenencint(packet.data + pos, &count);
+        pos += count;
+
+        flags = *(unsigned short*)(packet.data + pos);
+        if (SERVER_MORE_RESULTS_EXISTS != (flags & SERVER_MORE_RESULTS_EXISTS))
+            result = 0;
+    }
+    else
+    {
+        /*
+         * Next resultset column count
+         */
+        *stage = 0;
+    }
+
+    db_mysql_store_packet(detached, &packet);
+    db_mysql_free(connection, &packet);
+
+    if (by_fetch)
+    {
+        /*
+         * Take all rows of server side cursor at once
+         */
+        cmd_fetch[0] = COM_STMT_FETCH;
+        *(int*)(cmd_fetch + 1) = statement_id;
+        *(int*)(cmd_fetch + 5) = 0x7fffffff;
+
+        iov.data = cmd_fetch;
+        iov.size = 9;
+
+        if (DB_OK != db_mysql_writev(connection, 0, &iov, 1))
+            return -1;
+    }
+
+    return result;
+}
+
+static void db_mysql_result_store_free(db_mysql_connection_t* detached)
+{
+    api_pool_t* pool = api_pool_default(detached->session->base.loop);
+
+    db_mysql_buffers_free(detached);
+    db_mysql_store_free(detached);
+    db_error_cleanup(pool, &detached->error);
+    api_free(pool, sizeof(*detached), detached);
+}
+
+int db_mysql_result_store(db_mysql_result_t* result)
+{
+    db_mysql_connection_t* connection = result->connection;
+    db_mysql_connection_t* detached;
+    int stage = 0;
+    int code;
+
+    if (connection->store.active)
+        return DB_OK;
+
+    db_mysql_result_join(result);
+
+    if (connection->undefined)
+        return DB_UNAVAILABLE;
+
+    if (result->num_columns == 0 || result->columns != 0)
+    {
+        /*
+         * Only whole response can be stored
+         */
+        return DB_OUT_OF_SYNC;
+    }
+
+    detached = db_mysql_result_detached_create(connection);
+
+    do
+    {
+        code = db_mysql_result_store_packet(connection, detached, &stage, result->statement_id);
+    }
+    while (code > 0);
+
+    if (code < 0)
+    {
+        connection->undefined = 1;
+        db_mysql_result_store_free(detached);
+        return DB_UNAVAILABLE;
+    }
+
+    db_mysql_result_detach(result, detached);
+
+    return DB_OK;
+}
+
+int db_mysql_result_open_cursor(db_mysql_result_t* result)
+{
+    db_mysql_connection_t* connection = result->connection;
+    db_mysql_connection_t* detached;
+    db_column_t* columns;
+    int num_columns;
+    int code;
+
+    code = db_mysql_result_fetch_columns(result, &columns, &num_columns);
+    if (DB_OK != code)
+        return code;
+
+    result->columns_ready = 1;
+
+    if (result->by_fetch)
+    {
+        /*
+         * Nothing is sent by server until fetched, each batch is read
+         * at once to detached connection, see db_mysql_result_fetch_more
+         */
+        detached = db_mysql_result_detached_create(connection);
+        detached->store.origin = connection;
+
+        db_mysql_result_detach(result, detached);
+    }
+
+    return DB_OK;
+}
+
 int db_mysql_result_close(db_mysql_result_t* result)
 {
-    return db_mysql_eat_result(result->connection);
+    db_mysql_connection_t* connection = result->connection;
+    int code;
+
+    code = db_mysql_eat_result(connection);
+
+    if (connection->store.active)
+        db_mysql_result_store_free(connection);
+
+    return code;
 }
\ No newline at end of file
@@ -52,6 +52,12 @@ int db_mysql_session_start(api_loop_t* loop, db_engine_t* engine, db_mysql_sessi
     }
 
     mysql_session->port = engine->db.mysql.port;
+    mysql_session->flags = engine->db.mysql.flags;
+    mysql_session->abort_threshold = engine->db.mysql.abort_threshold;
+    mysql_session->read_ahead = engine->db.mysql.read_ahead;
+    mysql_session->fetch_size = engine->db.mysql.fetch_size;
+    if (mysql_session->fetch_size == 0)
+        mysql_session->fetch_size = DB_MYSQL_FETCH_SIZE;
 
     length = strlen(engine->db.mysql.username);
     if (length > 0)
@@ -87,8 +93,11 @@ int db_mysql_session_start(api_loop_t* loop, db_engine_t* engine, db_mysql_sessi
     iface->connection.open = (db_connection_open_fn)db_mysql_connection_open;
     iface->connection.error = (db_connection_error_fn)db_mysql_connection_error;
     iface->connection.query = (db_connection_query_fn)db_mysql_connection_query;
+    iface->connection.send_query = (db_connection_send_query_fn)db_mysql_connection_send_query;
+    iface->connection.read_result = (db_connection_read_result_fn)db_mysql_connection_read_result;
     iface->connection.affected = (db_connection_affected_fn)db_mysql_connection_affected;
     iface->connection.insert_id = (db_connection_insert_id_fn)db_mysql_connection_insert_id;
+    iface->connection.load = (db_connection_load_fn)db_mysql_connection_load;
     iface->connection.begin = (db_connection_begin_fn)db_mysql_connection_begin;
     iface->connection.commit = (db_connection_commit_fn)db_mysql_connection_commit;
     iface->connection.rollback = (db_connection_rollback_fn)db_mysql_connection_rollback;
@@ -112,13 +121,30 @@ int db_mysql_session_start(api_loop_t* loop, db_engine_t* engine, db_mysql_sessi
     iface->statement.bind_string = (db_statement_bind_string_fn)db_mysql_statement_bind_string;
     iface->statement.bind_binary = (db_statement_bind_binary_fn)db_mysql_statement_bind_binary;
     iface->statement.bind_blob = (db_statement_bind_blob_fn)db_mysql_statement_bind_blob;
+    iface->statement.bind_stream = (db_statement_bind_stream_fn)db_mysql_statement_bind_stream;
+    iface->statement.bind_ref = (db_statement_bind_ref_fn)db_mysql_statement_bind_ref;
+    iface->statement.bind_struct = (db_statement_bind_struct_fn)db_mysql_statement_bind_struct;
     iface->statement.exec = (db_statement_exec_fn)db_mysql_statement_exec;
+    iface->statement.exec_cursor = (db_statement_exec_fn)db_mysql_statement_exec_cursor;
+    iface->statement.exec_batch = (db_statement_exec_batch_fn)db_mysql_statement_exec_batch;
+    iface->statement.send_exec = (db_statement_send_exec_fn)db_mysql_statement_send_exec;
     iface->statement.close = (db_statement_close_fn)db_mysql_statement_close;
 
     iface->result.fetch_columns = (db_result_fetch_columns_fn)db_mysql_result_fetch_columns;
     iface->result.fetch_rows = (db_result_fetch_rows_fn)db_mysql_result_fetch_rows;
+    iface->result.fetch_lazy = (db_result_fetch_lazy_fn)db_mysql_result_fetch_lazy;
+    iface->result.fetch_rowset = (db_result_fetch_rowset_fn)db_mysql_result_fetch_rowset;
+    iface->result.fetch_vectors = (db_result_fetch_vectors_fn)db_mysql_result_fetch_vectors;
+    iface->result.next_row = (db_result_next_row_fn)db_mysql_result_next_row;
+    iface->result.fetch_each = (db_result_fetch_each_fn)db_mysql_result_fetch_each;
+    iface->result.fetch_stream = (db_result_fetch_stream_fn)db_mysql_result_fetch_stream;
+    iface->result.bind = (db_result_bind_fn)db_mysql_result_bind;
+    iface->result.fetch_bound = (db_result_fetch_bound_fn)db_mysql_result_fetch_bound;
+    iface->result.store = (db_result_store_fn)db_mysql_result_store;
     iface->result.close = (db_result_close_fn)db_mysql_result_close;
 
+    iface->row.get = (db_row_get_fn)db_mysql_row_get;
+
     *session = mysql_session;
 
     /*
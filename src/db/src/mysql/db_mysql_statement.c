@@ -21,15 +21,28 @@
 
 #include "db_mysql.h"
 
+/*
+ * Frees copy of string or binary value, referenced values are left to caller
+ */
+static void db_mysql_statement_release(api_pool_t* pool, db_mysql_statement_t* statement, int index)
+{
+    if (statement->values[index].size > 0 && !statement->by_ref[index])
+        api_free(pool, statement->values[index].size + 1, statement->values[index].value_binary);
+
+    statement->values[index].value_binary = 0;
+    statement->values[index].size = 0;
+    statement->by_ref[index] = 0;
+}
+
 void db_mysql_statement_free_values(api_pool_t* pool, db_mysql_statement_t* statement)
 {
     int i;
 
     for (i = 0; i < statement->num_params; ++i)
     {
-        if (0 != statement->values[i].is_null)
+        if (0 == statement->values[i].is_null)
         {
-            statement->params_changed = 1;
+            statement->changed[i] = 1;
 
             switch (statement->params[i].type)
             {
@@ -38,13 +51,12 @@ void db_mysql_statement_free_values(api_pool_t* pool, db_mysql_statement_t* stat
                 /*
                  * For binary & string we reserve one more char for trailing '\0'
                  */
-                if (statement->values[i].size > 0)
-                    api_free(pool, statement->values[i].size + 1, statement->values[i].value_string);
-                statement->values[i].size = 0;
+                db_mysql_statement_release(pool, statement, i);
                 break;
             }
 
             statement->values[i].is_null = 1;
+            statement->long_data[i] = 0;
         }
     }
 }
@@ -66,8 +78,15 @@ void db_mysql_statement_free(api_pool_t* pool, db_mysql_statement_t* statement)
         api_free(pool, statement->num_params * sizeof(db_column_t), statement->params);
         api_free(pool, statement->num_params * sizeof(db_value_t), statement->values);
         api_free(pool, statement->num_params * sizeof(int), statement->mysql_types);
+        api_free(pool, statement->num_params, statement->long_data);
+        api_free(pool, statement->num_params, statement->by_ref);
+        api_free(pool, statement->num_params, statement->changed);
+        api_free(pool, statement->num_params * sizeof(db_mysql_slot_t), statement->exec.slots);
     }
 
+    if (statement->exec.capacity > 0)
+        api_free(pool, statement->exec.capacity, statement->exec.data);
+
     api_free(pool, sizeof(*statement), statement);
 }
 
@@ -87,7 +106,7 @@ int db_mysql_statement_bind_natural(db_mysql_statement_t* statement, int index,
         {
             statement->values[index].is_null = 0;
             statement->values[index].value_int64 = value;
-            statement->params_changed = 1;
+            statement->changed[index] = 1;
         }
 
         break;
@@ -109,8 +128,8 @@ int db_mysql_statement_bind_natural(db_mysql_statement_t* statement, int index,
 int db_mysql_statement_prepare(db_mysql_connection_t* connection, const char* sql, db_mysql_statement_t** statement)
 {
     api_pool_t* pool = api_pool_default(connection->session->base.loop);
-    int sql_length = strlen(sql);
-    char command[5];
+    char command = COM_STMT_PREPARE;
+    db_mysql_iovec_t iov[2];
     db_mysql_packet_t packet;
     db_mysql_status_t status;
     int error = 0;
@@ -124,33 +143,22 @@ int db_mysql_statement_prepare(db_mysql_connection_t* connection, const char* sq
         return DB_UNKNOWN;
 
     /*
-     * Eat pending resultsets
+     * Eat pending resultsets and pipelined responses
      */
-    db_mysql_eat_result(connection);
+    db_mysql_sync(connection);
 
     /*
-     * Send COM_PREPARE command
+     * Send COM_PREPARE command and sql by single write
      */
 
-    *(int*)command = 1 /* COM_STMT_PREPARE */
-                   + sql_length;
-
-    command[3] = 0; // reset sequence
-    command[4] = COM_STMT_PREPARE;
-
-    /* header and code */
-    if (5 != api_stream_write(&connection->tcp.stream, command, 5))
-    {
-        connection->undefined = 1;
-        return DB_UNAVAILABLE;
-    }
+    iov[0].data = &command;
+    iov[0].size = 1;
+    iov[1].data = sql;
+    iov[1].size = strlen(sql);
 
-    /* sql */
-    if (sql_length != api_stream_write(&connection->tcp.stream, sql, sql_length))
-    {
-        connection->undefined = 1;
-        return DB_UNAVAILABLE;
-    }
+    error = db_mysql_writev(connection, 0 /* reset sequence */, iov, 2);
+    if (DB_OK != error)
+        return error;
 
     /*
      * Parse statement
@@ -179,6 +187,8 @@ int db_mysql_statement_prepare(db_mysql_connection_t* connection, const char* sq
 
     *statement = (db_mysql_statement_t*)api_calloc(pool, sizeof(**statement));
     (*statement)->connection = connection;
+    (*statement)->types_changed = 1;
+    (*statement)->layout_changed = 1;
     (*statement)->id = *(int*)(packet.data + 1);
     num_columns = *(short*)(packet.data + 1 + 4);
     (*statement)->num_params = *(short*)(packet.data + 1 + 4 + 2);
@@ -195,6 +205,10 @@ int db_mysql_statement_prepare(db_mysql_connection_t* connection, const char* sq
         (*statement)->params = (db_column_t*)api_calloc(pool, (*statement)->num_params * sizeof(db_column_t));
         (*statement)->values = (db_value_t*)api_calloc(pool, (*statement)->num_params * sizeof(db_value_t));
         (*statement)->mysql_types = (int*)api_calloc(pool, (*statement)->num_params * sizeof(int));
+        (*statement)->long_data = (char*)api_calloc(pool, (*statement)->num_params);
+        (*statement)->by_ref = (char*)api_calloc(pool, (*statement)->num_params);
+        (*statement)->changed = (char*)api_calloc(pool, (*statement)->num_params);
+        (*statement)->exec.slots = (db_mysql_slot_t*)api_calloc(pool, (*statement)->num_params * sizeof(db_mysql_slot_t));
 
         i = 0;
         while (i < (*statement)->num_params)
@@ -344,28 +358,25 @@ int db_mysql_statement_reset(db_mysql_statement_t* statement)
 {
     api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
     db_mysql_status_t status;
-    char command[9];
+    char command[5];
+    db_mysql_iovec_t iov;
     int i;
 
     /*
-     * Eat pending resultsets
+     * Eat pending resultsets and pipelined responses
      */
-    db_mysql_eat_result(statement->connection);
+    db_mysql_sync(statement->connection);
 
     db_mysql_statement_free_values(pool, statement);
 
-    command[0] = 5; // payload size
-    command[1] = 0;
-    command[2] = 0;
-    command[3] = 0; // sequence number
-    command[4] = COM_STMT_RESET;
-    *(int*)(command + 5) = statement->id;
+    command[0] = COM_STMT_RESET;
+    *(int*)(command + 1) = statement->id;
 
-    if (9 != api_stream_write(&statement->connection->tcp.stream, command, 9))
-    {
-        statement->connection->undefined = 1;
+    iov.data = command;
+    iov.size = 5;
+
+    if (DB_OK != db_mysql_writev(statement->connection, 0, &iov, 1))
         return DB_UNAVAILABLE;
-    }
 
     if (DB_OK != db_mysql_status_read(statement->connection, &status))
     {
@@ -384,12 +395,15 @@ int db_mysql_statement_reset(db_mysql_statement_t* statement)
         return DB_FAILED;
     else if (status.code == PACKET_OK)
     {
+        statement->types_changed = 1;
+        statement->layout_changed = 1;
+
         for (i = 0; i < statement->num_params; ++i)
         {
             /*
              * Call through iface, in case when iface was hooked
              */
-            statement->connection->session->base.iface.statement.bind_null((db_statement_t*)statement, 0);
+            statement->connection->session->base.iface.statement.bind_null((db_statement_t*)statement, i);
         }
 
         return DB_OK;
@@ -415,17 +429,16 @@ int db_mysql_statement_bind_null(db_mysql_statement_t* statement, int index)
     }
 
     statement->values[index].is_null = 1;
-    statement->params_changed = 1;
+    statement->long_data[index] = 0;
+    statement->changed[index] = 1;
 
     switch (statement->params[index].type) {
     case DB_TYPE_STRING:
     case DB_TYPE_BINARY:
         /*
-         * Free memory for pointer types
+         * Free memory for pointer types, streamed values has no local copy
          */
-        api_free(pool, statement->values[index].size + 1, statement->values[index].value_binary);
-        statement->values[index].value_binary = 0;
-        statement->values[index].size = 0;
+        db_mysql_statement_release(pool, statement, index);
         return DB_OK;
     }
 
@@ -580,7 +593,7 @@ int db_mysql_statement_bind_float(db_mysql_statement_t* statement, int index, fl
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -624,7 +637,7 @@ int db_mysql_statement_bind_double(db_mysql_statement_t* statement, int index, d
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -660,7 +673,7 @@ int db_mysql_statement_bind_time(db_mysql_statement_t* statement, int index, db_
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -696,7 +709,7 @@ int db_mysql_statement_bind_date(db_mysql_statement_t* statement, int index, db_
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -732,7 +745,7 @@ int db_mysql_statement_bind_datetime(db_mysql_statement_t* statement, int index,
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -768,7 +781,7 @@ int db_mysql_statement_bind_timestamp(db_mysql_statement_t* statement, int index
     if (!is_equal)
     {
         statement->values[index].is_null = 0;
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
@@ -796,15 +809,15 @@ int db_mysql_statement_bind_binary(db_mysql_statement_t* statement, int index, v
     case DB_TYPE_BINARY:
         is_equal = (is_null && size > 0 || !is_null && size == 0) &&
                 size == statement->values[index].size &&
-                0 == memcmp(statement->values[index].value_string, value, size);
+                0 == memcmp(statement->values[index].value_string, value, size) &&
+                !statement->long_data[index] &&
+                !statement->by_ref[index];
 
         if (!is_equal)
         {
-            if (statement->values[index].size > 0)
-                api_free(pool, statement->values[index].size + 1, statement->values[index].value_string);
+            statement->long_data[index] = 0;
 
-            statement->values[index].size = 0;
-            statement->values[index].value_string = 0;
+            db_mysql_statement_release(pool, statement, index);
             statement->values[index].is_null = size == 0;
 
             if (size > 0)
@@ -827,392 +840,1126 @@ int db_mysql_statement_bind_binary(db_mysql_statement_t* statement, int index, v
 
     if (!is_equal)
     {
-        statement->params_changed = 1;
+        statement->changed[index] = 1;
     }
 
     return DB_OK;
 }
 
-int db_mysql_statement_bind_blob(db_mysql_statement_t* statement, int index, void* value, uint64_t size)
+int db_mysql_statement_bind_ref(db_mysql_statement_t* statement, int index, const void* value, uint64_t size)
 {
     api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
-    char command[4 + 7];
 
     if (index < 0 || index >= statement->num_params)
         return DB_OUT_OF_INDEX;
 
-    if (statement->connection->undefined)
-        return DB_UNKNOWN;
+    switch (statement->params[index].type)
+    {
+    case DB_TYPE_STRING:
+    case DB_TYPE_BINARY:
+        break;
+
+    default:
+        /*
+         * param type not compatible with value type
+         */
+        return DB_MISMATCH;
+    }
+
+    /*
+     * Caller's memory is read on execution, large values are written
+     * to socket from their place
+     */
+    statement->long_data[index] = 0;
 
-    command[0] = 7; // payload size
-    command[1] = 0;
-    command[2] = 0;
-    command[3] = 0; // sequence number
-    command[4] = COM_STMT_LONG_DATA;
-    *(int*)(command + 5) = statement->id;
-    *(short*)(command + 5 + 4) = index;
+    db_mysql_statement_release(pool, statement, index);
 
-    if (4 + 7 != api_stream_write(&statement->connection->tcp.stream, command, 4 + 7))
+    statement->values[index].is_null = size == 0;
+
+    if (size > 0)
     {
-        statement->connection->undefined = 1;
-        return DB_UNAVAILABLE;
+        statement->values[index].value_binary = (void*)value;
+        statement->values[index].size = size;
+        statement->by_ref[index] = 1;
     }
 
-    if (size != api_stream_write(&statement->connection->tcp.stream, (char*)value, size))
+    statement->changed[index] = 1;
+
+    return DB_OK;
+}
+
+/*
+ * Binds number or temporal value from caller's memory, other types bind null
+ */
+static int db_mysql_statement_bind_field(db_mysql_statement_t* statement, int index, int type, const char* field)
+{
+    switch (type)
     {
-        statement->connection->undefined = 1;
-        return DB_UNAVAILABLE;
+    case DB_TYPE_BOOL:
+        return db_mysql_statement_bind_bool(statement, index, *(char*)field);
+    case DB_TYPE_BYTE:
+        return db_mysql_statement_bind_byte(statement, index, *(char*)field);
+    case DB_TYPE_SHORT:
+        return db_mysql_statement_bind_short(statement, index, *(short*)field);
+    case DB_TYPE_INT:
+        return db_mysql_statement_bind_int(statement, index, *(int*)field);
+    case DB_TYPE_INT64:
+        return db_mysql_statement_bind_int64(statement, index, *(int64_t*)field);
+    case DB_TYPE_FLOAT:
+        return db_mysql_statement_bind_float(statement, index, *(float*)field);
+    case DB_TYPE_DOUBLE:
+        return db_mysql_statement_bind_double(statement, index, *(double*)field);
+    case DB_TYPE_TIME:
+        return db_mysql_statement_bind_time(statement, index, (db_time_t*)field);
+    case DB_TYPE_DATE:
+        return db_mysql_statement_bind_date(statement, index, (db_date_t*)field);
+    case DB_TYPE_DATETIME:
+        return db_mysql_statement_bind_datetime(statement, index, (db_date_t*)field);
+    case DB_TYPE_TIMESTAMP:
+        return db_mysql_statement_bind_timestamp(statement, index, (db_date_t*)field);
     }
 
-    return DB_OK;
+    return db_mysql_statement_bind_null(statement, index);
 }
 
-int db_mysql_statement_exec(db_mysql_statement_t* statement, db_mysql_result_t** result)
+int db_mysql_statement_bind_struct(db_mysql_statement_t* statement, db_param_t* params, int count, const void* base)
 {
-    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
-    db_mysql_packet_t packet;
-    char* pos = 0;
+    const char* field;
+    const char* data;
+    uint64_t size;
+    int code = DB_OK;
     int i;
-    int code;
 
-    if (result)
-        *result = 0;
+    if (count != statement->num_params)
+        return DB_OUT_OF_INDEX;
 
-    /*
-     * Eat pending resultsets
-     */
-    db_mysql_eat_result(statement->connection);
+    for (i = 0; i < count && DB_OK == code; ++i)
+    {
+        field = (const char*)base + params[i].offset;
+
+        switch (params[i].type)
+        {
+        case DB_TYPE_STRING:
+        case DB_TYPE_BINARY:
+            /*
+             * Field is pointer to value, null pointer binds null
+             */
+            data = *(const char**)field;
 
-    packet.sequence = 0;
+            if (data == 0)
+                size = 0;
+            else if (params[i].type == DB_TYPE_STRING)
+                size = strlen(data);
+            else
+                size = *(uint64_t*)((const char*)base + params[i].size_offset);
 
-    /*
-     * Calculate payload size in bytes
-     */
+            if (params[i].by_ref)
+                code = db_mysql_statement_bind_ref(statement, i, data, size);
+            else
+                code = db_mysql_statement_bind_binary(statement, i, (void*)data, size);
+            break;
+        default:
+            code = db_mysql_statement_bind_field(statement, i, params[i].type, field);
+            break;
+        }
+    }
 
-    packet.size = 1  // COM_STMT_EXECUTE
-                + 4  // statement id
-                + 1  // flags
-                + 4; // iteration count = 0
+    return code;
+}
 
-    if (statement->num_params > 0)
+/*
+ * Sends one chunk of parameter value by COM_STMT_SEND_LONG_DATA.
+ * Server appends chunks and replies nothing
+ */
+static int db_mysql_statement_send_long_data(db_mysql_statement_t* statement, int index, const char* data, size_t size)
+{
+    char command[7];
+    db_mysql_iovec_t iov[2];
+
+    command[0] = COM_STMT_LONG_DATA;
+    *(int*)(command + 1) = statement->id;
+    *(short*)(command + 1 + 4) = index;
+
+    iov[0].data = command;
+    iov[0].size = 7;
+    iov[1].data = data;
+    iov[1].size = size;
+
+    return db_mysql_writev(statement->connection, 0, iov, 2);
+}
+
+/*
+ * Prepares parameter to receive long data, value is not kept locally
+ * and is not sent with COM_STMT_EXECUTE
+ */
+static int db_mysql_statement_begin_long_data(db_mysql_statement_t* statement, int index)
+{
+    if (index < 0 || index >= statement->num_params)
+        return DB_OUT_OF_INDEX;
+
+    switch (statement->params[index].type)
     {
-        packet.size += (statement->num_params + 7) / 8; // null mask
-        packet.size += 1; // new params bound
+    case DB_TYPE_STRING:
+    case DB_TYPE_BINARY:
+        break;
 
-        if (statement->params_changed)
-        {
-            packet.size += statement->num_params * 2; // types
+    default:
+        /*
+         * param type not compatible with value type
+         */
+        return DB_MISMATCH;
+    }
 
-            for (i = 0; i < statement->num_params; ++i)
-            {
-                if (!statement->values[i].is_null)
-                {
-                    switch (statement->params[i].type) {
-                    case DB_TYPE_BOOL:
-                    case DB_TYPE_BYTE:
-                        packet.size += 1;
-                        break;
-                    case DB_TYPE_SHORT:
-                        packet.size += 2;
-                        break;
-                    case DB_TYPE_INT:
-                    case DB_TYPE_FLOAT:
-                        packet.size += 4; 
-                        break;
-                    case DB_TYPE_INT64:
-                    case DB_TYPE_DOUBLE:
-                        packet.size += 8; 
-                        break;
-                    case DB_TYPE_TIME:
-                        if (statement->values[i].value_time.days == 0 &&
-                            statement->values[i].value_time.hours == 0 &&
-                            statement->values[i].value_time.minutes == 0 &&
-                            statement->values[i].value_time.seconds == 0 &&
-                            statement->values[i].value_time.microseconds == 0)
-                        {
-                            packet.size += 1; // [0]
-                        }
-                        else
-                        {
-                            if (statement->values[i].value_time.microseconds == 0)
-                            {
-                                packet.size += 9; // [8][+/-][dddd][h][m][s]
-                            }
-                            else
-                            {
-                                packet.size += 13; // [12][+/-][dddd][h][m][s][uuuu]
-                            }
-                        }
-                        break;
-                    case DB_TYPE_DATE:
-                    case DB_TYPE_DATETIME:
-                    case DB_TYPE_TIMESTAMP: 
-                        if (statement->values[i].value_date.year == 0 &&
-                            statement->values[i].value_date.month == 0 &&
-                            statement->values[i].value_date.day == 0 &&
-                            statement->values[i].value_date.hour == 0 &&
-                            statement->values[i].value_date.minute == 0 &&
-                            statement->values[i].value_date.second == 0 &&
-                            statement->values[i].value_date.microsecond == 0)
-                        {
-                            packet.size += 1; // [0]
-                        }
-                        else
-                        {
-                            if (statement->values[i].value_date.hour == 0 &&
-                                statement->values[i].value_date.minute == 0 &&
-                                statement->values[i].value_date.second == 0 &&
-                                statement->values[i].value_date.microsecond == 0)
-                            {
-                                 packet.size += 5; // [4][yy][m][d]
-                            }
-                            else
-                            {
-                                if (statement->values[i].value_date.microsecond == 0)
-                                {
-                                    packet.size += 8; // [7][yy][m][d][h][m][s]
-                                }
-                                else
-                                {
-                                    packet.size += 12; // [11][yy][m][d][h][m][s][uuuu]
-                                }
-                            }
-                        }
-                        break;
-                    default:
-                        /* 
-                         * ToDo: for large data use BIND_LONG_DATA
-                         */
-                        packet.size += db_mysql_calc_lenencstr_size(statement->values[i].size);
-                        break;
-                    }
-                }
-            }
-        }
+    if (statement->connection->undefined)
+        return DB_UNKNOWN;
+
+    /*
+     * Release previous value, server already may have chunks of
+     * previous long data, which are appended to
+     */
+    if (!statement->long_data[index])
+    {
+        statement->connection->session->base.iface.statement.bind_null((db_statement_t*)statement, index);
+
+        statement->values[index].is_null = 0;
+        statement->long_data[index] = 1;
+        statement->changed[index] = 1;
     }
 
-    packet.data = (char*)api_alloc(pool, packet.size);
+    return DB_OK;
+}
+
+int db_mysql_statement_bind_blob(db_mysql_statement_t* statement, int index, void* value, uint64_t size)
+{
+    const char* data = (const char*)value;
+    size_t chunk;
+    int code;
+
+    code = db_mysql_statement_begin_long_data(statement, index);
+    if (DB_OK != code)
+        return code;
 
     /*
-     * Fill buffer with headers and values
+     * Chunks are sent from their place without copying,
+     * and are gathered with following execute command
      */
 
-    pos = packet.data;
-    *pos++ = COM_STMT_EXECUTE;
-    *(int*)pos = statement->id;
-    pos += 4;
-    *pos++ = 0; // flags
-    *(int*)pos = 1; // iteration count
-    pos += 4;
+    statement->connection->output.defer = 1;
 
-    if (statement->num_params > 0)
+    do
     {
-        for (i = 0; i < (statement->num_params + 7) / 8; ++i)
-            pos[i] = 0;
+        chunk = size > DB_MYSQL_LONG_DATA_SIZE ? DB_MYSQL_LONG_DATA_SIZE : (size_t)size;
+        code = db_mysql_statement_send_long_data(statement, index, data, chunk);
 
-        for (i = 0; i < statement->num_params; ++i)
-        {
-            *(pos + (i / 8)) |= (statement->values[i].is_null << (i % 8));
-        }
+        data += chunk;
+        size -= chunk;
+    }
+    while (DB_OK == code && size > 0);
 
-        pos += (statement->num_params + 7) / 8;
+    statement->connection->output.defer = 0;
+
+    return code;
+}
+
+int db_mysql_statement_bind_stream(db_mysql_statement_t* statement, int index, db_read_fn fn, void* arg)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    char* chunk;
+    size_t size;
+    int done = 0;
+    int count;
+    int code;
+
+    code = db_mysql_statement_begin_long_data(statement, index);
+    if (DB_OK != code)
+        return code;
+
+    chunk = (char*)api_alloc(pool, DB_MYSQL_LONG_DATA_SIZE);
 
-        *pos++ = statement->params_changed;
+    statement->connection->output.defer = 1;
 
-        if (statement->params_changed)
+    while (DB_OK == code && !done)
+    {
+        /*
+         * Fill up whole chunk, to not send many small packets
+         * when source produces data by small pieces
+         */
+        size = 0;
+        while (size < DB_MYSQL_LONG_DATA_SIZE)
         {
-            for (i = 0; i < statement->num_params; ++i)
+            count = fn(arg, chunk + size, DB_MYSQL_LONG_DATA_SIZE - size);
+            if (count <= 0)
             {
-                *(short*)pos = (short)statement->mysql_types[i];
-                pos += 2;
-            }
+                if (count < 0)
+                    code = DB_FAILED;
 
-            for (i = 0; i < statement->num_params; ++i)
-            {
-                if (!statement->values[i].is_null)
-                {
-                    switch (statement->params[i].type) {
-                    case DB_TYPE_BOOL:
-                    case DB_TYPE_BYTE:
-                        *pos++ = statement->values[i].value_byte;
-                        packet.size += 1;
-                        break;
-                    case DB_TYPE_SHORT:
-                        *(short*)pos = statement->values[i].value_short;
-                        pos += 2;
-                        break;
-                    case DB_TYPE_INT:
-                        *(int*)pos = statement->values[i].value_int;
-                        pos += 4;
-                        break;
-                    case DB_TYPE_FLOAT:
-                        *(float*)pos = statement->values[i].value_float;
-                        pos += 4;
-                        break;
-                    case DB_TYPE_INT64:
-                        *(int64_t*)pos = statement->values[i].value_int64;
-                        pos += 8;
-                        break;
-                    case DB_TYPE_DOUBLE:
-                        *(double*)pos = statement->values[i].value_double;
-                        pos += 8;
-                        break;
-                    case DB_TYPE_TIME:
-                        if (statement->values[i].value_time.days == 0 &&
-                            statement->values[i].value_time.hours == 0 &&
-                            statement->values[i].value_time.minutes == 0 &&
-                            statement->values[i].value_time.seconds == 0 &&
-                            statement->values[i].value_time.microseconds == 0)
-                        {
-                            *pos++ = 0; // [0]
-                        }
-                        else
-                        {
-                            if (statement->values[i].value_time.microseconds == 0)
-                            {
-                                // [8][+/-][dddd][h][m][s]
-                                *pos++ = 8;
-                                *pos++ = statement->values[i].value_time.is_negative;
-                                *(int*)pos = statement->values[i].value_time.days; pos+= 4;
-                                *pos++ = statement->values[i].value_time.hours;
-                                *pos++ = statement->values[i].value_time.minutes;
-                                *pos++ = statement->values[i].value_time.seconds;
-                            }
-                            else
-                            {
-                                // [12][+/-][dddd][h][m][s][uuuu]
-                                *pos++ = 12;
-                                *(int*)pos = statement->values[i].value_time.days; pos+= 4;
-                                *pos++ = statement->values[i].value_time.hours;
-                                *pos++ = statement->values[i].value_time.minutes;
-                                *pos++ = statement->values[i].value_time.seconds;
-                                *(int*)pos = statement->values[i].value_time.microseconds; pos+= 4;
-                            }
-                        }
-                        break;
-                    case DB_TYPE_DATE:
-                    case DB_TYPE_DATETIME:
-                    case DB_TYPE_TIMESTAMP: 
-                        if (statement->values[i].value_date.year == 0 &&
-                            statement->values[i].value_date.month == 0 &&
-                            statement->values[i].value_date.day == 0 &&
-                            statement->values[i].value_date.hour == 0 &&
-                            statement->values[i].value_date.minute == 0 &&
-                            statement->values[i].value_date.second == 0 &&
-                            statement->values[i].value_date.microsecond == 0)
-                        {
-                            *pos++ = 0; // [0]
-                        }
-                        else
-                        {
-                            if (statement->values[i].value_date.hour == 0 &&
-                                statement->values[i].value_date.minute == 0 &&
-                                statement->values[i].value_date.second == 0 &&
-                                statement->values[i].value_date.microsecond == 0)
-                            {
-                                // [4][yy][m][d]
-                                *pos++ = 4;
-                                *(short*)pos = statement->values[i].value_date.year; pos+= 2;
-                                *pos++ = statement->values[i].value_date.month;
-                                *pos++ = statement->values[i].value_date.day;
-                            }
-                            else
-                            {
-                                if (statement->values[i].value_date.microsecond == 0)
-                                {
-                                    // [7][yy][m][d][h][m][s]
-                                    *pos++ = 7;
-                                    *(short*)pos = statement->values[i].value_date.year; pos+= 2;
-                                    *pos++ = statement->values[i].value_date.month;
-                                    *pos++ = statement->values[i].value_date.day;
-                                    *pos++ = statement->values[i].value_date.hour;
-                                    *pos++ = statement->values[i].value_date.minute;
-                                    *pos++ = statement->values[i].value_date.second;
-                                }
-                                else
-                                {
-                                    // [11][yy][m][d][h][m][s][uuuu]
-                                    *pos++ = 11;
-                                    *(short*)pos = statement->values[i].value_date.year; pos+= 2;
-                                    *pos++ = statement->values[i].value_date.month;
-                                    *pos++ = statement->values[i].value_date.day;
-                                    *pos++ = statement->values[i].value_date.hour;
-                                    *pos++ = statement->values[i].value_date.minute;
-                                    *pos++ = statement->values[i].value_date.second;
-                                    *(int*)pos = statement->values[i].value_date.microsecond; pos+= 4;
-                                }
-                            }
-                        }
-                        break;
-                    default:
-                        /* 
-                         * ToDo: for large data use BIND_LONG_DATA
-                         */
-                        pos = db_mysql_write_lenencint(pos, statement->values[i].size);
-                        memcpy(pos, statement->values[i].value_binary, statement->values[i].size);
-                        pos += statement->values[i].size;
-                        break;
-                    }
-                }
+                done = 1;
+                break;
             }
+
+            size += count;
         }
+
+        if (DB_OK == code && size > 0)
+            code = db_mysql_statement_send_long_data(statement, index, chunk, size);
     }
 
-    /*
-     * Sent command
-     */
+    statement->connection->output.defer = 0;
 
-    code = db_mysql_write(statement->connection, &packet);
+    api_free(pool, DB_MYSQL_LONG_DATA_SIZE, chunk);
 
-    db_mysql_free(statement->connection, &packet);
+    if (DB_FAILED == code)
+    {
+        /*
+         * Server keeps partially sent value, discard it by reset
+         */
+        if (DB_OK != db_mysql_statement_reset(statement))
+            return DB_UNAVAILABLE;
 
-    if (DB_OK != code)
-        return code;
+        return DB_FAILED;
+    }
 
-    /*
-     * Read result
-     */
+    return code;
+}
 
-    code = db_mysql_read_result(statement->connection, statement->id);
-    if (DB_OK == code)
-    {
-        if (statement->connection->result != 0)
-            statement->connection->result->statement_id = statement->id;
+/*
+ * Bytes taken by value in COM_STMT_EXECUTE, values of direct size
+ * and larger take only their length prefix there
+ */
+static size_t db_mysql_statement_value_size(db_mysql_statement_t* statement, int i)
+{
+    db_value_t* value = &statement->values[i];
 
-        if (result != 0)
+    switch (statement->params[i].type) {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        return 1;
+    case DB_TYPE_SHORT:
+        return 2;
+    case DB_TYPE_INT:
+    case DB_TYPE_FLOAT:
+        return 4;
+    case DB_TYPE_INT64:
+    case DB_TYPE_DOUBLE:
+        return 8;
+    case DB_TYPE_TIME:
+        if (value->value_time.days == 0 &&
+            value->value_time.hours == 0 &&
+            value->value_time.minutes == 0 &&
+            value->value_time.seconds == 0 &&
+            value->value_time.microseconds == 0)
         {
-            *result = statement->connection->result;
+            return 1; // [0]
         }
-        else
+
+        if (value->value_time.microseconds == 0)
+            return 9; // [8][+/-][dddd][h][m][s]
+
+        return 13; // [12][+/-][dddd][h][m][s][uuuu]
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        if (value->value_date.hour == 0 &&
+            value->value_date.minute == 0 &&
+            value->value_date.second == 0 &&
+            value->value_date.microsecond == 0)
         {
-            db_mysql_eat_result(statement->connection);
+            if (value->value_date.year == 0 &&
+                value->value_date.month == 0 &&
+                value->value_date.day == 0)
+            {
+                return 1; // [0]
+            }
+
+            return 5; // [4][yy][m][d]
         }
+
+        if (value->value_date.microsecond == 0)
+            return 8; // [7][yy][m][d][h][m][s]
+
+        return 12; // [11][yy][m][d][h][m][s][uuuu]
     }
 
-    return code;
+    if (value->size >= DB_MYSQL_DIRECT_SIZE)
+        return (size_t)(db_mysql_calc_lenencstr_size(value->size) - value->size);
+
+    return (size_t)db_mysql_calc_lenencstr_size(value->size);
 }
 
-int db_mysql_statement_close(db_mysql_statement_t* statement)
+static char db_mysql_statement_slot_state(db_mysql_statement_t* statement, int i)
 {
-    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
-    char command[4 + 5];
-    int code = DB_OK;
+    if (statement->long_data[i])
+        return DB_MYSQL_SLOT_LONG_DATA;
 
-    /*
-     * Send COM_STMT_CLOSE command
-     */
+    if (statement->values[i].is_null)
+        return DB_MYSQL_SLOT_NULL;
 
-    *(int*)command = 5;
-    command[3] = 0; // reset sequence
-    command[4] = COM_STMT_CLOSE;
-    *(int*)(command + 5) = statement->id;
+    return DB_MYSQL_SLOT_VALUE;
+}
 
-    if (4 + 5 != api_stream_write(&statement->connection->tcp.stream, command, 4 + 5))
-    {
-        statement->connection->undefined = 1;
-        code = DB_UNAVAILABLE;
+/*
+ * Value fits in its slot when it is encoded by same count of bytes,
+ * and for strings when it has same size, so that length prefix and
+ * direct sending do not change
+ */
+static uint64_t db_mysql_statement_slot_length(db_mysql_statement_t* statement, int i)
+{
+    switch (statement->params[i].type) {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+    case DB_TYPE_SHORT:
+    case DB_TYPE_INT:
+    case DB_TYPE_FLOAT:
+    case DB_TYPE_INT64:
+    case DB_TYPE_DOUBLE:
+    case DB_TYPE_TIME:
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        return db_mysql_statement_value_size(statement, i);
     }
 
+    return statement->values[i].size;
+}
+
+/*
+ * Large strings are written to socket from their place, see db_mysql_statement_write_value
+ */
+static int db_mysql_statement_is_direct(db_mysql_statement_t* statement, int i)
+{
+    return db_mysql_statement_slot_length(statement, i) >= DB_MYSQL_DIRECT_SIZE &&
+           db_mysql_statement_value_size(statement, i) < DB_MYSQL_DIRECT_SIZE;
+}
+
+/*
+ * Writes value in binary protocol form, returns position after it
+ */
+static char* db_mysql_statement_write_value(db_mysql_statement_t* statement, int i, char* pos)
+{
+    db_value_t* value = &statement->values[i];
+
+    switch (statement->params[i].type) {
+    case DB_TYPE_BOOL:
+    case DB_TYPE_BYTE:
+        *pos++ = value->value_byte;
+        break;
+    case DB_TYPE_SHORT:
+        *(short*)pos = value->value_short;
+        pos += 2;
+        break;
+    case DB_TYPE_INT:
+        *(int*)pos = value->value_int;
+        pos += 4;
+        break;
+    case DB_TYPE_FLOAT:
+        *(float*)pos = value->value_float;
+        pos += 4;
+        break;
+    case DB_TYPE_INT64:
+        *(int64_t*)pos = value->value_int64;
+        pos += 8;
+        break;
+    case DB_TYPE_DOUBLE:
+        *(double*)pos = value->value_double;
+        pos += 8;
+        break;
+    case DB_TYPE_TIME:
+        switch (db_mysql_statement_value_size(statement, i)) {
+        case 1:
+            *pos++ = 0; // [0]
+            break;
+        case 9:
+            // [8][+/-][dddd][h][m][s]
+            *pos++ = 8;
+            *pos++ = value->value_time.is_negative;
+            *(int*)pos = value->value_time.days; pos+= 4;
+            *pos++ = value->value_time.hours;
+            *pos++ = value->value_time.minutes;
+            *pos++ = value->value_time.seconds;
+            break;
+        default:
+            // [12][+/-][dddd][h][m][s][uuuu]
+            *pos++ = 12;
+            *pos++ = value->value_time.is_negative;
+            *(int*)pos = value->value_time.days; pos+= 4;
+            *pos++ = value->value_time.hours;
+            *pos++ = value->value_time.minutes;
+            *pos++ = value->value_time.seconds;
+            *(int*)pos = value->value_time.microseconds; pos+= 4;
+            break;
+        }
+        break;
+    case DB_TYPE_DATE:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+        switch (db_mysql_statement_value_size(statement, i)) {
+        case 1:
+            *pos++ = 0; // [0]
+            break;
+        case 5:
+            // [4][yy][m][d]
+            *pos++ = 4;
+            *(short*)pos = value->value_date.year; pos+= 2;
+            *pos++ = value->value_date.month;
+            *pos++ = value->value_date.day;
+            break;
+        case 8:
+            // [7][yy][m][d][h][m][s]
+            *pos++ = 7;
+            *(short*)pos = value->value_date.year; pos+= 2;
+            *pos++ = value->value_date.month;
+            *pos++ = value->value_date.day;
+            *pos++ = value->value_date.hour;
+            *pos++ = value->value_date.minute;
+            *pos++ = value->value_date.second;
+            break;
+        default:
+            // [11][yy][m][d][h][m][s][uuuu]
+            *pos++ = 11;
+            *(short*)pos = value->value_date.year; pos+= 2;
+            *pos++ = value->value_date.month;
+            *pos++ = value->value_date.day;
+            *pos++ = value->value_date.hour;
+            *pos++ = value->value_date.minute;
+            *pos++ = value->value_date.second;
+            *(int*)pos = value->value_date.microsecond; pos+= 4;
+            break;
+        }
+        break;
+    default:
+        pos = db_mysql_write_lenencint(pos, value->size);
+
+        /*
+         * Large values are sent from their place, only length prefix goes into packet
+         */
+        if (value->size < DB_MYSQL_DIRECT_SIZE)
+        {
+            memcpy(pos, value->value_binary, (size_t)value->size);
+            pos += value->size;
+        }
+        break;
+    }
+
+    return pos;
+}
+
+/*
+ * Lays out COM_STMT_EXECUTE payload and remembers where each value is,
+ * buffer grows only and is kept until statement is closed
+ */
+static void db_mysql_statement_layout(db_mysql_statement_t* statement)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    db_mysql_slot_t* slot;
+    size_t size;
+    char* pos;
+    int i;
+
+    size = 1  // COM_STMT_EXECUTE
+         + 4  // statement id
+         + 1  // flags
+         + 4; // iteration count
+
+    if (statement->num_params > 0)
+    {
+        size += (statement->num_params + 7) / 8; // null mask
+        size += 1; // new params bound
+
+        if (statement->types_changed)
+            size += statement->num_params * 2; // types
+
+        for (i = 0; i < statement->num_params; ++i)
+        {
+            statement->exec.slots[i].state = db_mysql_statement_slot_state(statement, i);
+
+            if (statement->exec.slots[i].state == DB_MYSQL_SLOT_VALUE)
+                size += db_mysql_statement_value_size(statement, i);
+        }
+    }
+
+    if (size > statement->exec.capacity)
+    {
+        if (statement->exec.capacity > 0)
+            api_free(pool, statement->exec.capacity, statement->exec.data);
+
+        statement->exec.data = (char*)api_alloc(pool, size);
+        statement->exec.capacity = size;
+    }
+
+    statement->exec.size = size;
+    statement->exec.num_direct = 0;
+
+    pos = statement->exec.data;
+    *pos++ = COM_STMT_EXECUTE;
+    *(int*)pos = statement->id;
+    pos += 4;
+    *pos++ = 0; // flags, set on each execution
+    *(int*)pos = 1; // iteration count
+    pos += 4;
+
+    if (statement->num_params > 0)
+    {
+        for (i = 0; i < (statement->num_params + 7) / 8; ++i)
+            pos[i] = 0;
+
+        for (i = 0; i < statement->num_params; ++i)
+        {
+            if (statement->exec.slots[i].state == DB_MYSQL_SLOT_NULL)
+                *(pos + (i / 8)) |= (1 << (i % 8));
+        }
+
+        pos += (statement->num_params + 7) / 8;
+
+        *pos++ = (char)statement->types_changed;
+
+        if (statement->types_changed)
+        {
+            for (i = 0; i < statement->num_params; ++i)
+            {
+                *(short*)pos = (short)statement->mysql_types[i];
+                pos += 2;
+            }
+        }
+
+        /*
+         * Values are sent by each execution, regardless of new params bound flag
+         */
+        for (i = 0; i < statement->num_params; ++i)
+        {
+            slot = &statement->exec.slots[i];
+            slot->offset = pos - statement->exec.data;
+            slot->length = 0;
+
+            if (slot->state == DB_MYSQL_SLOT_VALUE)
+            {
+                slot->length = db_mysql_statement_slot_length(statement, i);
+                pos = db_mysql_statement_write_value(statement, i, pos);
+
+                if (db_mysql_statement_is_direct(statement, i))
+                    ++statement->exec.num_direct;
+            }
+
+            statement->changed[i] = 0;
+        }
+    }
+
+    statement->layout_changed = 0;
+}
+
+/*
+ * Sends COM_STMT_EXECUTE with bound parameters
+ */
+static int db_mysql_statement_send_command(db_mysql_statement_t* statement)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    db_mysql_iovec_t local_iov[8];
+    db_mysql_iovec_t* iov = local_iov;
+    db_mysql_slot_t* slot;
+    int num_iov;
+    size_t segment;
+    size_t end;
+    char state;
+    int i;
+    int code;
+
+    /*
+     * Patch changed values in place, while they fit into their slots.
+     * Referenced values are copied again, caller's memory is read on
+     * each execution regardless of value size
+     */
+    for (i = 0; i < statement->num_params && !statement->layout_changed; ++i)
+    {
+        if (statement->changed[i] || statement->by_ref[i])
+        {
+            slot = &statement->exec.slots[i];
+            state = db_mysql_statement_slot_state(statement, i);
+
+            if (state != slot->state ||
+                (state == DB_MYSQL_SLOT_VALUE && slot->length != db_mysql_statement_slot_length(statement, i)))
+            {
+                statement->layout_changed = 1;
+                break;
+            }
+
+            if (state == DB_MYSQL_SLOT_VALUE)
+                db_mysql_statement_write_value(statement, i, statement->exec.data + slot->offset);
+
+            statement->changed[i] = 0;
+        }
+    }
+
+    if (statement->layout_changed)
+        db_mysql_statement_layout(statement);
+
+    statement->exec.data[5] = (char)statement->cursor; // flags
+
+    num_iov = statement->exec.num_direct * 2 + 1;
+
+    if (num_iov > (int)(sizeof(local_iov) / sizeof(local_iov[0])))
+        iov = (db_mysql_iovec_t*)api_alloc(pool, num_iov * sizeof(db_mysql_iovec_t));
+
+    /*
+     * Buffer is split by values sent from their place
+     */
+    num_iov = 0;
+    segment = 0;
+
+    for (i = 0; i < statement->num_params && num_iov < statement->exec.num_direct * 2; ++i)
+    {
+        slot = &statement->exec.slots[i];
+
+        if (slot->state == DB_MYSQL_SLOT_VALUE && db_mysql_statement_is_direct(statement, i))
+        {
+            end = slot->offset + db_mysql_statement_value_size(statement, i);
+
+            iov[num_iov].data = statement->exec.data + segment;
+            iov[num_iov].size = end - segment;
+            ++num_iov;
+            iov[num_iov].data = (char*)statement->values[i].value_binary;
+            iov[num_iov].size = (size_t)statement->values[i].size;
+            ++num_iov;
+
+            segment = end;
+        }
+    }
+
+    iov[num_iov].data = statement->exec.data + segment;
+    iov[num_iov].size = statement->exec.size - segment;
+    ++num_iov;
+
+    /*
+     * Sent command by single write
+     */
+
+    code = db_mysql_writev(statement->connection, 0, iov, num_iov);
+
+    if (DB_OK == code && statement->types_changed)
+    {
+        /*
+         * Server keeps types, next executions send values only
+         */
+        statement->types_changed = 0;
+        statement->layout_changed = 1;
+    }
+
+    /*
+     * Server discards long data after execution, so such params
+     * must be streamed again before next one
+     */
+    for (i = 0; i < statement->num_params; ++i)
+    {
+        if (statement->long_data[i])
+        {
+            statement->long_data[i] = 0;
+            statement->values[i].is_null = 1;
+            statement->changed[i] = 1;
+        }
+    }
+
+    if (iov != local_iov)
+        api_free(pool, (statement->exec.num_direct * 2 + 1) * sizeof(db_mysql_iovec_t), iov);
+
+    return code;
+}
+
+int db_mysql_statement_exec(db_mysql_statement_t* statement, db_mysql_result_t** result)
+{
+    int code;
+
+    if (result)
+        *result = 0;
+
+    /*
+     * Eat pending resultsets and pipelined responses
+     */
+    db_mysql_sync(statement->connection);
+
+    code = db_mysql_statement_send_command(statement);
+    statement->cursor = CURSOR_TYPE_NO_CURSOR;
+
+    if (DB_OK != code)
+        return code;
+
+    /*
+     * Read result
+     */
+
+    code = db_mysql_read_result(statement->connection, statement->id);
+    if (DB_OK == code)
+    {
+        if (statement->connection->result != 0)
+            statement->connection->result->statement_id = statement->id;
+
+        if (result != 0)
+        {
+            *result = statement->connection->result;
+        }
+        else
+        {
+            db_mysql_eat_result(statement->connection);
+        }
+    }
+
+    return code;
+}
+
+int db_mysql_statement_exec_cursor(db_mysql_statement_t* statement, db_mysql_result_t** result)
+{
+    int code;
+
+    /*
+     * Rows are kept by server until asked by COM_STMT_FETCH,
+     * see db_mysql_result_fetch_more
+     */
+    statement->cursor = CURSOR_TYPE_READ_ONLY;
+
+    code = db_mysql_statement_exec(statement, result);
+    if (DB_OK != code || result == 0 || *result == 0)
+        return code;
+
+    /*
+     * Connection is released for other cursors and commands
+     */
+    code = db_mysql_result_open_cursor(*result);
+    if (DB_OK != code)
+    {
+        db_mysql_result_close(*result);
+        *result = 0;
+    }
+
+    return code;
+}
+
+int db_mysql_statement_send_exec(db_mysql_statement_t* statement)
+{
+    int code;
+
+    /*
+     * Gather command with other pipelined ones, response is read
+     * by db_mysql_connection_read_result
+     */
+
+    statement->connection->output.defer = 1;
+    code = db_mysql_statement_send_command(statement);
+    statement->connection->output.defer = 0;
+
+    if (DB_OK == code)
+        db_mysql_pipeline_push(statement->connection, statement->id);
+
+    return code;
+}
+
+/*
+ * Binds values of row from caller's arrays, strings and binaries are referenced
+ */
+static int db_mysql_statement_bind_row(db_mysql_statement_t* statement, db_binding_t* bindings, uint64_t row)
+{
+    db_binding_t* binding;
+    const char* field;
+    const char* end;
+    uint64_t size;
+    size_t offset;
+    int code = DB_OK;
+    int i;
+
+    for (i = 0; i < statement->num_params && DB_OK == code; ++i)
+    {
+        binding = &bindings[i];
+        offset = (size_t)row * binding->stride;
+        field = (const char*)binding->data + offset;
+
+        if (binding->type == 0 || (binding->is_null != 0 && binding->is_null[offset]))
+        {
+            code = db_mysql_statement_bind_null(statement, i);
+            continue;
+        }
+
+        switch (binding->type)
+        {
+        case DB_TYPE_STRING:
+        case DB_TYPE_BINARY:
+            if (binding->length != 0)
+            {
+                size = *(uint64_t*)((char*)binding->length + offset);
+            }
+            else if (binding->type == DB_TYPE_STRING)
+            {
+                end = (const char*)memchr(field, 0, (size_t)binding->size);
+                size = end != 0 ? (uint64_t)(end - field) : binding->size;
+            }
+            else
+            {
+                size = binding->size;
+            }
+
+            code = db_mysql_statement_bind_ref(statement, i, field, size);
+            break;
+        default:
+            code = db_mysql_statement_bind_field(statement, i, binding->type, field);
+            break;
+        }
+    }
+
+    return code;
+}
+
+/*
+ * Makes room for size bytes more in exec.data, keeping its content
+ */
+static void db_mysql_statement_reserve(db_mysql_statement_t* statement, size_t size)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    size_t capacity = statement->exec.capacity;
+    char* buffer;
+
+    if (statement->exec.size + size <= capacity)
+        return;
+
+    capacity = capacity > 0 ? 2 * capacity : DB_MYSQL_OUTPUT_SIZE;
+    if (capacity < statement->exec.size + size)
+        capacity = statement->exec.size + size;
+
+    buffer = (char*)api_alloc(pool, capacity);
+
+    if (statement->exec.capacity > 0)
+    {
+        memcpy(buffer, statement->exec.data, statement->exec.size);
+        api_free(pool, statement->exec.capacity, statement->exec.data);
+    }
+
+    statement->exec.data = buffer;
+    statement->exec.capacity = capacity;
+}
+
+/*
+ * Sends rows by COM_STMT_BULK_EXECUTE commands of up to DB_MYSQL_BULK_SIZE bytes,
+ * server answers each by single OK with affected rows of all its rows
+ */
+static int db_mysql_statement_exec_bulk(db_mysql_statement_t* statement, db_binding_t* bindings, uint64_t rows)
+{
+    db_mysql_connection_t* connection = statement->connection;
+    db_mysql_iovec_t iov;
+    uint64_t affected = 0;
+    uint64_t insert_id = 0;
+    uint64_t row = 0;
+    uint64_t first;
+    size_t size;
+    char* pos;
+    int code = DB_OK;
+    int i;
+
+    while (DB_OK == code && row < rows)
+    {
+        statement->exec.size = 0;
+        db_mysql_statement_reserve(statement, 1 + 4 + 2 + statement->num_params * 2);
+
+        pos = statement->exec.data;
+        *pos++ = (char)COM_STMT_BULK_EXECUTE;
+        *(int*)pos = statement->id;
+        pos += 4;
+        *(short*)pos = STMT_BULK_FLAG_SEND_TYPES_TO_SERVER;
+        pos += 2;
+
+        for (i = 0; i < statement->num_params; ++i)
+        {
+            *(short*)pos = (short)statement->mysql_types[i];
+            pos += 2;
+        }
+
+        statement->exec.size = pos - statement->exec.data;
+        first = row;
+
+        while (row < rows && statement->exec.size < DB_MYSQL_BULK_SIZE)
+        {
+            code = db_mysql_statement_bind_row(statement, bindings, row);
+            if (DB_OK != code)
+                break;
+
+            size = statement->num_params; // indicators
+            for (i = 0; i < statement->num_params; ++i)
+            {
+                if (!statement->values[i].is_null)
+                {
+                    size += db_mysql_statement_value_size(statement, i);
+
+                    if (db_mysql_statement_is_direct(statement, i))
+                        size += (size_t)statement->values[i].size;
+                }
+            }
+
+            db_mysql_statement_reserve(statement, size);
+            pos = statement->exec.data + statement->exec.size;
+
+            /*
+             * Values follow their indicators, there is no null bitmap
+             */
+            for (i = 0; i < statement->num_params; ++i)
+            {
+                if (statement->values[i].is_null)
+                {
+                    *pos++ = STMT_INDICATOR_NULL;
+                }
+                else
+                {
+                    *pos++ = STMT_INDICATOR_NONE;
+                    pos = db_mysql_statement_write_value(statement, i, pos);
+
+                    if (db_mysql_statement_is_direct(statement, i))
+                    {
+                        memcpy(pos, statement->values[i].value_binary, (size_t)statement->values[i].size);
+                        pos += statement->values[i].size;
+                    }
+                }
+            }
+
+            statement->exec.size = pos - statement->exec.data;
+            ++row;
+        }
+
+        if (DB_OK != code)
+            break;
+
+        iov.data = statement->exec.data;
+        iov.size = statement->exec.size;
+
+        code = db_mysql_writev(connection, 0, &iov, 1);
+        if (DB_OK == code)
+            code = db_mysql_read_result(connection, statement->id);
+
+        if (DB_OK == code)
+        {
+            if (first == 0)
+                insert_id = connection->insert_id;
+
+            affected += connection->affected;
+        }
+    }
+
+    connection->affected = affected;
+    connection->insert_id = insert_id;
+
+    return code;
+}
+
+/*
+ * Sends rows by pipelined COM_STMT_EXECUTE commands. Responses are read after
+ * each DB_MYSQL_BATCH_WINDOW commands, so that server is not blocked on
+ * writing them while commands are still written
+ */
+static int db_mysql_statement_exec_pipelined(db_mysql_statement_t* statement, db_binding_t* bindings, uint64_t rows)
+{
+    db_mysql_connection_t* connection = statement->connection;
+    uint64_t affected = 0;
+    uint64_t insert_id = 0;
+    uint64_t row = 0;
+    int first = 1;
+    int statement_id;
+    int sent;
+    int status;
+    int code = DB_OK;
+
+    while (DB_OK == code && row < rows)
+    {
+        connection->output.defer = 1;
+
+        for (sent = 0; sent < DB_MYSQL_BATCH_WINDOW && row < rows; ++sent)
+        {
+            code = db_mysql_statement_bind_row(statement, bindings, row);
+            if (DB_OK == code)
+                code = db_mysql_statement_send_command(statement);
+
+            if (DB_OK != code)
+                break;
+
+            db_mysql_pipeline_push(connection, statement->id);
+            ++row;
+        }
+
+        connection->output.defer = 0;
+
+        /*
+         * Keep error of first failed row
+         */
+        while (db_mysql_pipeline_pop(connection, &statement_id))
+        {
+            if (connection->undefined)
+                continue;
+
+            status = db_mysql_read_result(connection, statement_id);
+            db_mysql_eat_result(connection);
+
+            if (DB_OK == status && DB_OK == code)
+            {
+                if (first)
+                    insert_id = connection->insert_id;
+
+                affected += connection->affected;
+                first = 0;
+            }
+            else if (DB_OK == code)
+            {
+                code = status;
+            }
+        }
+
+        if (DB_OK == code && connection->undefined)
+            code = DB_UNAVAILABLE;
+    }
+
+    connection->affected = affected;
+    connection->insert_id = insert_id;
+
+    return code;
+}
+
+int db_mysql_statement_exec_batch(db_mysql_statement_t* statement, db_binding_t* bindings, int count, uint64_t rows)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    int code;
+
+    if (count != statement->num_params)
+        return DB_OUT_OF_INDEX;
+
+    /*
+     * Eat pending resultsets and pipelined responses
+     */
+    db_mysql_sync(statement->connection);
+
+    statement->cursor = CURSOR_TYPE_NO_CURSOR;
+
+    if (statement->connection->session->server.mariadb_capabilities & MARIADB_CLIENT_STMT_BULK_OPERATIONS)
+        code = db_mysql_statement_exec_bulk(statement, bindings, rows);
+    else
+        code = db_mysql_statement_exec_pipelined(statement, bindings, rows);
+
+    /*
+     * Values referenced caller's arrays, buffer may hold bulk command
+     */
+    db_mysql_statement_free_values(pool, statement);
+    statement->layout_changed = 1;
+
+    return code;
+}
+
+int db_mysql_statement_close(db_mysql_statement_t* statement)
+{
+    api_pool_t* pool = api_pool_default(statement->connection->session->base.loop);
+    char command[5];
+    db_mysql_iovec_t iov;
+    int code = DB_OK;
+
+    /*
+     * Send COM_STMT_CLOSE command
+     */
+
+    command[0] = COM_STMT_CLOSE;
+    *(int*)(command + 1) = statement->id;
+
+    iov.data = command;
+    iov.size = 5;
+
+    code = db_mysql_writev(statement->connection, 0, &iov, 1);
+
     db_mysql_statement_free(pool, statement);
 
     return code;
@@ -24,6 +24,8 @@
  */
 
 #include <stdio.h>
+#include <string.h> /* for memset */
+#include <stddef.h> /* for offsetof */
 
 #include "../../db/include/db.h"
 
@@ -213,6 +215,387 @@ void db_uc_query()
     }
 }
 
+int print_each_row(void* arg, db_value_t* row, int num_columns)
+{
+    print_row((db_column_t*)arg, row, num_columns);
+
+    return 0; // continue
+}
+
+void db_uc_next_row()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+    db_column_t* columns;
+    db_value_t* row;
+    int num_columns;
+
+    printf("\r\n\r\nusecase reading rows one by one\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_connection_query(connection, "Select * From `country`", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK)
+            {
+                print_columns(columns, num_columns);
+
+                /*
+                 * Pull first rows, row buffer is reused by each call
+                 */
+                while (db_result_next_row(result, &row) == DB_OK && row[0].value_int64 < 10)
+                    print_row(columns, row, num_columns);
+
+                /*
+                 * Push the rest to callback
+                 */
+                db_result_fetch_each(result, print_each_row, columns);
+            }
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_cursor()
+{
+    db_connection_t* connection;
+    db_statement_t* statement;
+    db_result_t* result;
+    db_column_t* columns;
+    db_value_t* row;
+    int num_columns;
+    int num_rows = 0;
+
+    printf("\r\n\r\nusecase paging through rows by server side cursor\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_statement_prepare(connection, "Select * From `city` Where `ID` > ?", &statement) == DB_OK)
+        {
+            db_statement_bind_int(statement, /* index*/ 0, /* value */ 0);
+
+            /*
+             * Rows are sent by server in batches of engine.db.mysql.fetch_size bytes
+             */
+            if (db_statement_exec_cursor(statement, &result) == DB_OK)
+            {
+                if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK)
+                {
+                    while (db_result_next_row(result, &row) == DB_OK)
+                        ++num_rows;
+
+                    printf("%d rows\r\n", num_rows);
+                }
+
+                db_result_close(result);
+            }
+
+            db_statement_close(statement);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_cursors()
+{
+    db_connection_t* connection;
+    db_statement_t* statement1;
+    db_statement_t* statement2;
+    db_result_t* result1;
+    db_result_t* result2;
+    db_column_t* columns;
+    db_value_t* row1;
+    db_value_t* row2;
+    int num_columns;
+    int matches = 0;
+
+    printf("\r\n\r\nusecase two cursors fetched by turns on single connection\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_statement_prepare(connection, "Select `ID` From `city` Order By `ID`", &statement1) == DB_OK)
+        {
+            if (db_statement_prepare(connection, "Select `ID` From `city` Where `ID` % 2 = 0 Order By `ID`", &statement2) == DB_OK)
+            {
+                if (db_statement_exec_cursor(statement1, &result1) == DB_OK)
+                {
+                    if (db_statement_exec_cursor(statement2, &result2) == DB_OK)
+                    {
+                        db_result_fetch_columns(result1, &columns, &num_columns);
+                        db_result_fetch_columns(result2, &columns, &num_columns);
+
+                        /*
+                         * Merge join of two ordered cursors
+                         */
+                        if (db_result_next_row(result1, &row1) == DB_OK && db_result_next_row(result2, &row2) == DB_OK)
+                        {
+                            while (1)
+                            {
+                                if (row1[0].value_int == row2[0].value_int)
+                                {
+                                    ++matches;
+
+                                    if (db_result_next_row(result1, &row1) != DB_OK || db_result_next_row(result2, &row2) != DB_OK)
+                                        break;
+                                }
+                                else if (row1[0].value_int < row2[0].value_int)
+                                {
+                                    if (db_result_next_row(result1, &row1) != DB_OK)
+                                        break;
+                                }
+                                else if (db_result_next_row(result2, &row2) != DB_OK)
+                                {
+                                    break;
+                                }
+                            }
+                        }
+
+                        printf("%d matches\r\n", matches);
+
+                        db_result_close(result2);
+                    }
+
+                    db_result_close(result1);
+                }
+
+                db_statement_close(statement2);
+            }
+
+            db_statement_close(statement1);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+typedef struct city_t {
+    int id;
+    char name[36];
+    char country[4];
+    int64_t population;
+} city_t;
+
+void db_uc_bind()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+    db_column_t* columns;
+    db_binding_t bindings[4];
+    city_t cities[16];
+    int num_columns;
+    int count;
+    int i;
+
+    printf("\r\n\r\nusecase rows decoded into array of structs\r\n");
+
+    memset(bindings, 0, sizeof(bindings));
+
+    bindings[0].type = DB_TYPE_INT;
+    bindings[0].data = &cities[0].id;
+    bindings[1].type = DB_TYPE_STRING;
+    bindings[1].data = cities[0].name;
+    bindings[1].size = sizeof(cities[0].name);
+    bindings[2].type = DB_TYPE_STRING;
+    bindings[2].data = cities[0].country;
+    bindings[2].size = sizeof(cities[0].country);
+    bindings[3].type = DB_TYPE_INT64;
+    bindings[3].data = &cities[0].population;
+
+    for (i = 0; i < 4; ++i)
+        bindings[i].stride = sizeof(city_t);
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_connection_query(connection, "Select `ID`, `Name`, `CountryCode`, `Population` From `city` limit 100", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK &&
+                db_result_bind(result, bindings, num_columns) == DB_OK)
+            {
+                count = 16;
+                while (db_result_fetch_bound(result, &count) == DB_OK && count > 0)
+                {
+                    for (i = 0; i < count; ++i)
+                        printf("%d %s %s %lld\r\n", cities[i].id, cities[i].name, cities[i].country, (long long)cities[i].population);
+
+                    count = 16;
+                }
+            }
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_vectors()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+    db_column_t* columns;
+    db_vector_t* vectors;
+    int num_columns;
+    int num_rows;
+    int64_t sum;
+    int i;
+
+    printf("\r\n\r\nusecase reading rows by columns\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_connection_query(connection, "Select `ID`, `Name` From `country`", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK)
+            {
+                sum = 0;
+                num_rows = 100; // rows per batch
+
+                while (db_result_fetch_vectors(result, &vectors, &num_rows) == DB_OK && num_rows > 0)
+                {
+                    /*
+                     * Values array element type follows column type
+                     */
+                    for (i = 0; i < num_rows; ++i)
+                    {
+                        if (0 == (vectors[0].validity[i / 8] & (1 << (i % 8))))
+                            continue; // null
+
+                        if (vectors[0].type == DB_TYPE_INT)
+                            sum += ((int*)vectors[0].values)[i];
+                        else if (vectors[0].type == DB_TYPE_INT64)
+                            sum += ((int64_t*)vectors[0].values)[i];
+                    }
+
+                    num_rows = 100;
+                }
+
+                printf("sum of %s is %d\r\n", columns[0].name, (int)sum);
+            }
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_lazy()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+    db_column_t* columns;
+    db_row_t** rows;
+    db_value_t value;
+    int num_columns;
+    int num_rows;
+    int i;
+
+    printf("\r\n\r\nusecase decoding only accessed values\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        if (db_connection_query(connection, "Select * From `country` limit 10", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK && num_columns > 1)
+            {
+                num_rows = 0; // all rows
+
+                if (db_result_fetch_lazy(result, &rows, &num_rows) == DB_OK)
+                {
+                    for (i = 0; i < num_rows; ++i)
+                    {
+                        /*
+                         * Only second column is decoded
+                         */
+                        if (db_row_get(rows[i], 1, &value) == DB_OK)
+                            print_row(columns + 1, &value, 1);
+                    }
+                }
+            }
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_rowset()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+    db_column_t* columns;
+    db_rowset_t* rowset;
+    db_value_t** rows;
+    int num_columns;
+    int num_rows;
+    size_t value_bytes;
+    int i, j;
+
+    printf("\r\n\r\nusecase compact rows, bytes per row\r\n");
+
+    if (db_connection_open(session, &connection) == DB_OK)
+    {
+        /*
+         * Same rows as db_value_t rows
+         */
+        if (db_connection_query(connection, "Select * From `country`", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK)
+            {
+                num_rows = 0;
+
+                if (db_result_fetch_rows(result, &rows, &num_rows) == DB_OK && num_rows > 0)
+                {
+                    value_bytes = 0;
+
+                    for (i = 0; i < num_rows; ++i)
+                    {
+                        value_bytes += sizeof(db_value_t*) + num_columns * sizeof(db_value_t);
+
+                        for (j = 0; j < num_columns; ++j)
+                            if (!rows[i][j].is_null && (columns[j].type == DB_TYPE_STRING || columns[j].type == DB_TYPE_BINARY))
+                                value_bytes += (size_t)rows[i][j].size + 1;
+                    }
+
+                    printf("db_value_t rows: %d bytes per row\r\n", (int)(value_bytes / num_rows));
+                }
+            }
+
+            db_result_close(result);
+        }
+
+        /*
+         * and as rowset
+         */
+        if (db_connection_query(connection, "Select * From `country`", &result) == DB_OK)
+        {
+            if (db_result_fetch_columns(result, &columns, &num_columns) == DB_OK)
+            {
+                num_rows = 0;
+
+                if (db_result_fetch_rowset(result, &rowset, &num_rows) == DB_OK)
+                {
+                    printf("rowset: %d bytes per row\r\n", (int)(db_rowset_memory(rowset) / db_rowset_count(rowset)));
+
+                    /*
+                     * Rowset outlives result and connection
+                     */
+                    db_rowset_free(rowset);
+                }
+            }
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
 void db_uc_query_multiple()
 {
     db_connection_t* connection;
@@ -320,6 +703,212 @@ void db_uc_blob()
     }
 }
 
+int produce_bytes(void* arg, char* data, size_t size)
+{
+    uint64_t* left = (uint64_t*)arg;
+
+    if (size > *left)
+        size = (size_t)*left;
+
+    memset(data, 'x', size);
+    *left -= size;
+
+    return (int)size;
+}
+
+void db_uc_blob_stream()
+{
+    db_connection_t* connection;
+    db_statement_t* statement;
+    uint64_t affected;
+    uint64_t left = 1024 * 1024;
+
+    printf("\r\n\r\nusecase sending blob data by fragments\r\n");
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_statement_prepare(connection, "Update `tbl` Set `blob` = ? Where `ID` = 1", &statement))
+        {
+            /*
+             * Value is produced by chunks while being sent
+             */
+            db_statement_bind_stream(statement, /* index*/ 0, produce_bytes, &left);
+
+            db_statement_exec(statement, 0 /* dont need resultset */);
+
+            db_connection_affected(connection, &affected);
+
+            printf("affected %d\r\n", (int)affected);
+
+            db_statement_close(statement);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void count_bytes(void* arg, const char* data, size_t size)
+{
+    *(uint64_t*)arg += size;
+}
+
+void db_uc_stream()
+{
+    db_connection_t* connection;
+    db_statement_t* statement;
+    db_result_t* result;
+    db_column_t* columns;
+    int num_columns;
+    uint64_t size;
+    int is_null;
+
+    printf("\r\n\r\nusecase receiving large value by fragments\r\n");
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_statement_prepare(connection, "Select `ID`, `blob` From `tbl` Where `ID` = ?", &statement))
+        {
+            db_statement_bind_int(statement, /* index*/ 0, /* value */ 1);
+            if (DB_OK == db_statement_exec(statement, &result))
+            {
+                if (DB_OK == db_result_fetch_columns(result, &columns, &num_columns))
+                {
+                    size = 0;
+
+                    /*
+                     * Value is passed to callback as it arrives, without being assembled in memory
+                     */
+                    while (DB_OK == db_result_fetch_stream(result, /* column */ 1, count_bytes, &size, &is_null))
+                    {
+                        printf("blob %s, %d bytes\r\n", is_null ? "is null" : "received", (int)size);
+                        size = 0;
+                    }
+                }
+
+                db_result_close(result);
+            }
+
+            db_statement_close(statement);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_store()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+
+    printf("\r\n\r\nusecase stored result, connection released before fetch\r\n");
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_connection_query(connection, "Select * From `city` limit 10", &result))
+        {
+            if (DB_OK == db_result_store(result))
+            {
+                /*
+                 * Connection goes back to pool, result is read from memory
+                 */
+                db_connection_close(connection);
+                connection = 0;
+
+                print_result(result, 0 /* fetch all rows in single call */);
+            }
+
+            db_result_close(result);
+        }
+
+        if (connection != 0)
+            db_connection_close(connection);
+    }
+}
+
+void db_uc_store_multiple()
+{
+    db_connection_t* connection;
+    db_result_t* result;
+
+    printf("\r\n\r\nusecase stored multiple resultsets with intermediate OK\r\n");
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        /*
+         * OK of `Set` is followed by one more resultset, which is stored too
+         */
+        if (DB_OK == db_connection_query(connection,
+                "Select * From `city` limit 1;"
+                "Set @count = 1;"
+                "Select `Code`, `Name` From `country` limit 1", &result))
+        {
+            if (DB_OK == db_result_store(result))
+            {
+                db_connection_close(connection);
+                connection = 0;
+
+                print_result(result, 0 /* fetch all rows in single call */);
+            }
+
+            db_result_close(result);
+        }
+
+        if (connection != 0)
+            db_connection_close(connection);
+    }
+
+    /*
+     * Pooled connection has nothing left unread
+     */
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_connection_query(connection, "Select 1", &result))
+        {
+            print_result(result, 0 /* fetch all rows in single call */);
+
+            db_result_close(result);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_futures()
+{
+    const char* queries[3] = {
+        "Select * From `city` Where `ID` = 1",
+        "Select * From `country` limit 1",
+        "Select * From `countrylanguage` limit 1"
+    };
+    db_future_t* futures[3];
+    db_result_t* result;
+    int submitted = 0;
+    int i;
+
+    printf("\r\n\r\nusecase independent queries run in parallel\r\n");
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (DB_OK == db_future_submit_query(session, queries[i], &futures[submitted]))
+            ++submitted;
+    }
+
+    /*
+     * Each query runs on its own pooled connection, wait at most 5 seconds
+     */
+    if (DB_OK == db_future_when_all(futures, submitted, 5000))
+    {
+        for (i = 0; i < submitted; ++i)
+        {
+            if (DB_OK == db_future_wait(futures[i], 0, &result) && result != 0)
+                print_result(result, 0 /* fetch all rows in single call */);
+        }
+    }
+
+    for (i = 0; i < submitted; ++i)
+        db_future_close(futures[i]);
+}
+
 void db_uc_update()
 {
     db_connection_t* connection;
@@ -383,6 +972,160 @@ void db_uc_insert()
     }
 }
 
+typedef struct new_city_t {
+    const char* name;
+    const char* country_code;
+    const char* district;
+    int population;
+} new_city_t;
+
+void db_uc_insert_struct()
+{
+    db_connection_t* connection;
+    db_statement_t* statement;
+    new_city_t cities[] = {
+        { "Gyumri", "ARM", "Shirak", 120000 },
+        { "Vanadzor", "ARM", "Lori", 86000 }
+    };
+    db_param_t params[] = {
+        { DB_TYPE_STRING, offsetof(new_city_t, name), 0, /* by_ref */ 1 },
+        { DB_TYPE_STRING, offsetof(new_city_t, country_code), 0, 1 },
+        { DB_TYPE_STRING, offsetof(new_city_t, district), 0, 1 },
+        { DB_TYPE_INT, offsetof(new_city_t, population), 0, 0 }
+    };
+    int i;
+
+    printf("\r\n\r\nusecase insert from struct\r\n");
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_statement_prepare(connection, 
+            "Insert into `city` (`Name`, `CountryCode`, `District`, `Population`) Values (?,?,?,?)", &statement))
+        {
+            for (i = 0; i < 2; ++i)
+            {
+                /*
+                 * Strings are not copied, cities[i] must live until exec
+                 */
+                if (DB_OK == db_statement_bind_struct(statement, params, 4, &cities[i]))
+                    db_statement_exec(statement, 0 /* dont need resultset */);
+            }
+
+            db_statement_close(statement);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+void db_uc_insert_batch()
+{
+    db_connection_t* connection;
+    db_statement_t* statement;
+    db_binding_t bindings[4];
+    char names[100][32];
+    int populations[100];
+    uint64_t affected;
+    int i;
+
+    printf("\r\n\r\nusecase insert rows from arrays\r\n");
+
+    for (i = 0; i < 100; ++i)
+    {
+        sprintf(names[i], "Town %d", i);
+        populations[i] = 1000 + i;
+    }
+
+    /*
+     * Column wise arrays, value of row i is at data + i * stride
+     */
+    memset(bindings, 0, sizeof(bindings));
+
+    bindings[0].type = DB_TYPE_STRING;
+    bindings[0].data = names;
+    bindings[0].stride = sizeof(names[0]);
+    bindings[0].size = sizeof(names[0]);
+
+    bindings[1].type = DB_TYPE_STRING;
+    bindings[1].data = "ARM";
+    bindings[1].size = 3; // same value for all rows by zero stride
+
+    bindings[2].type = DB_TYPE_STRING;
+    bindings[2].data = "Shirak";
+    bindings[2].size = 6;
+
+    bindings[3].type = DB_TYPE_INT;
+    bindings[3].data = populations;
+    bindings[3].stride = sizeof(populations[0]);
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        if (DB_OK == db_statement_prepare(connection, 
+            "Insert into `city` (`Name`, `CountryCode`, `District`, `Population`) Values (?,?,?,?)", &statement))
+        {
+            if (DB_OK == db_statement_exec_batch(statement, bindings, 4, 100))
+            {
+                db_connection_affected(connection, &affected);
+                printf("affected %d\r\n", (int)affected);
+            }
+
+            db_statement_close(statement);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
+typedef struct towns_t {
+    int next;
+    int count;
+} towns_t;
+
+/*
+ * Formats tab separated rows on the fly
+ */
+static int db_uc_read_towns(void* arg, char* data, size_t size)
+{
+    towns_t* towns = (towns_t*)arg;
+    int length = 0;
+
+    while (towns->next < towns->count && size - length > 64)
+    {
+        length += sprintf(data + length, "Village %d\tARM\tLori\t%d\n", towns->next, 100 + towns->next);
+        ++towns->next;
+    }
+
+    return length;
+}
+
+void db_uc_load()
+{
+    db_connection_t* connection;
+    towns_t towns;
+    uint64_t affected;
+
+    printf("\r\n\r\nusecase load data local infile\r\n");
+
+    towns.next = 0;
+    towns.count = 10000;
+
+    if (DB_OK == db_connection_open(session, &connection))
+    {
+        /*
+         * Server may ask only for "towns.tsv", its content comes from callback
+         */
+        if (DB_OK == db_connection_load(connection,
+            "Load Data Local Infile 'towns.tsv' Into Table `city` (`Name`, `CountryCode`, `District`, `Population`)",
+            "towns.tsv", db_uc_read_towns, &towns))
+        {
+            db_connection_affected(connection, &affected);
+            printf("loaded %d\r\n", (int)affected);
+        }
+
+        db_connection_close(connection);
+    }
+}
+
 void db_uc_transaction()
 {
     db_connection_t* connection;
@@ -423,7 +1166,10 @@ void db_run_usecases(api_loop_t* loop, void* arg)
     engine.db.mysql.username = "MySQLUser";
     engine.db.mysql.password = "sasasa";
     engine.db.mysql.schema = "world";
-    engine.db.mysql.flags = 0;
+    engine.db.mysql.flags = DB_MYSQL_ABORT_KILL;
+    engine.db.mysql.abort_threshold = 1024 * 1024; // kill queries which rows are left unread over 1MB
+    engine.db.mysql.read_ahead = 256 * 1024; // next batch of db_result_fetch_rows is read while current one is printed
+    engine.db.mysql.fetch_size = 0; // default DB_MYSQL_FETCH_SIZE bytes of rows per cursor fetch
 
     /*
      * Start MySQL session
@@ -457,12 +1203,27 @@ void db_run_usecases(api_loop_t* loop, void* arg)
 
     db_uc_errors();
     db_uc_query();
+    db_uc_next_row();
+    db_uc_cursor();
+    db_uc_cursors();
+    db_uc_bind();
+    db_uc_vectors();
+    db_uc_lazy();
+    db_uc_rowset();
     db_uc_stored_procedure();
     db_uc_query_multiple();
     db_uc_exec();
     db_uc_blob();
+    db_uc_blob_stream();
+    db_uc_stream();
+    db_uc_store();
+    db_uc_store_multiple();
+    db_uc_futures();
     db_uc_update();
     db_uc_insert();
+    db_uc_insert_struct();
+    db_uc_insert_batch();
+    db_uc_load();
     db_uc_transaction();
 }
 